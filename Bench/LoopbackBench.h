@@ -0,0 +1,248 @@
+/*
+  ==============================================================================
+    Bench/LoopbackBench.h
+    End-to-end throughput and latency against a stand-in headset
+  ==============================================================================
+*/
+#pragma once
+#include "Core/BridgeEngine.h"
+#include "Core/LatencyHistogram.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// One direction of traffic. Every message carries an id the far end can
+// decode; the id's send time gives the latency and the order ids come back
+// in shows reordering. Ids wrap, so an id must arrive before it is reused
+// (numIds / rate seconds later), which is far beyond any usable latency.
+class LoopbackStream {
+public:
+  LoopbackStream(const char *streamName, int ids)
+      : name(streamName), numIds(ids), sentAt((size_t)ids) {}
+
+  // Sending thread: the id for the next message
+  int next() {
+    int id = (int)(sent % numIds);
+    sentAt[(size_t)id].store(LatencyHistogram::nowMicros(),
+                             std::memory_order_relaxed);
+    ++sent;
+    return id;
+  }
+
+  // Receiving thread (one per stream)
+  void received(int id) {
+    if (id < 0 || id >= numIds)
+      return;
+    latency.record(LatencyHistogram::nowMicros() -
+                   sentAt[(size_t)id].load(std::memory_order_relaxed));
+    ++receivedCount;
+    // More than half the id space back means it was overtaken
+    int step = (id - lastId + numIds) % numIds;
+    if (lastId >= 0 && step > numIds / 2)
+      ++reordered;
+    else
+      lastId = id;
+  }
+
+  void print(double seconds) const {
+    auto snap = latency.getSnapshot();
+    auto ms = [](juce::int64 us) { return us / 1000.0; };
+    juce::int64 s = sent, r = receivedCount;
+    std::printf("%-18s %9lld %9lld %9lld %9lld %10.0f %7.2f %7.2f %7.2f "
+                "%7.2f\n",
+                name, (long long)s, (long long)r,
+                (long long)juce::jmax<juce::int64>(0, s - r),
+                (long long)reordered.load(), r / seconds, ms(snap.p50),
+                ms(snap.p99), ms(snap.p999), ms(snap.max));
+  }
+
+private:
+  const char *name;
+  const int numIds;
+  std::vector<std::atomic<juce::int64>> sentAt; // by id, LatencyHistogram time
+  std::atomic<juce::int64> sent{0}, receivedCount{0}, reordered{0};
+  int lastId = -1; // receiving thread
+  LatencyHistogram latency;
+};
+
+// Stands up a BridgeEngine between a fake headset (an OSC peer on
+// 127.0.0.1) and a mock MIDI output, then drives both directions at once:
+//   headset -> bridge: /chXn notes and /chXwheel on channels 1-8, checked
+//                      at the MIDI output
+//   MIDI in -> bridge: notes and CCs on channels 9-16, checked at the peer
+// The channel split keeps the streams apart: MIDI input notes are also sent
+// to the MIDI output, and the sink ignores channels 9-16.
+class LoopbackBench : private juce::OSCReceiver::Listener<
+                          juce::OSCReceiver::RealtimeCallback> {
+public:
+  struct Settings {
+    int noteRate = 1000; // per second, each direction
+    int ccRate = 200;    // same
+    double seconds = 5.0;
+    bool bundle = false;
+  };
+
+  explicit LoopbackBench(const Settings &s) : settings(s) {
+    for (int ch = 1; ch <= 8; ++ch) {
+      noteAddresses.emplace_back("/ch" + juce::String(ch) + "n");
+      wheelAddresses.emplace_back("/ch" + juce::String(ch) + "wheel");
+    }
+  }
+
+  ~LoopbackBench() override {
+    peerReceiver.removeListener(this);
+    peerReceiver.disconnect();
+    engine.shutdown();
+  }
+
+  // Returns the process exit code
+  int run() {
+    if (!peerSocket.bindToPort(0, "127.0.0.1") ||
+        !peerReceiver.connectToSocket(peerSocket)) {
+      std::fprintf(stderr, "Loopback: cannot open the headset port\n");
+      return 1;
+    }
+    peerReceiver.addListener(this);
+    const int bridgePort = findFreePort();
+
+    engine.setKeyboardEchoes(false);
+    engine.setTrafficLogging(false);
+    engine.setProbeSettings(0, false);
+    engine.setOscBundling(settings.bundle, 1400);
+    engine.onMidiOut = [this](const juce::MidiMessage &m) { midiSink(m); };
+    engine.start();
+    engine.setLinkEnabled(false); // no peers joining mid-run
+    if (bridgePort == 0 ||
+        !engine.connectOsc("127.0.0.1", peerSocket.getBoundPort(),
+                           bridgePort) ||
+        !peerSender.connect("127.0.0.1", bridgePort)) {
+      std::fprintf(stderr, "Loopback: cannot open the bridge ports\n");
+      return 1;
+    }
+
+    std::printf("Loopback: %.1f s, %d notes/s + %d CC/s each way, "
+                "bundling %s\n\n",
+                settings.seconds, settings.noteRate, settings.ccRate,
+                settings.bundle ? "on" : "off");
+
+    std::thread headset([this] {
+      pace([this](juce::int64) { sendHeadsetNote(); },
+           [this](juce::int64) { sendHeadsetWheel(); });
+    });
+    std::thread midiIn([this] {
+      pace([this](juce::int64) { sendMidiInNote(); },
+           [this](juce::int64 i) { sendMidiInCC((int)(i % 128)); });
+    });
+    headset.join();
+    midiIn.join();
+    juce::Thread::sleep(500); // let the last packets land
+
+    std::printf("%-18s %9s %9s %9s %9s %10s %7s %7s %7s %7s\n", "stream",
+                "sent", "received", "dropped", "reordered", "msg/s", "p50",
+                "p99", "p99.9", "max ms");
+    for (auto *s : {&headsetNotes, &headsetWheel, &midiInNotes, &midiInCCs})
+      s->print(settings.seconds);
+    std::printf("\nBridge: %s\n", engine.getStatsString().toRawUTF8());
+    return 0;
+  }
+
+private:
+  // Ids -> messages. Headset notes skip 0 and 1: the bridge reads OSC
+  // values in (0, 1] as normalised, so a note number of 1 would become 127.
+  static constexpr int headsetNotesPerChannel = 126;
+
+  void sendHeadsetNote() {
+    int id = headsetNotes.next();
+    int ch = 1 + id / headsetNotesPerChannel;
+    float note = (float)(2 + id % headsetNotesPerChannel);
+    peerSender.send(
+        juce::OSCMessage(noteAddresses[(size_t)ch - 1], note, 0.8f));
+  }
+
+  // The id rides in the 14-bit bend value
+  void sendHeadsetWheel() {
+    int id = headsetWheel.next();
+    peerSender.send(juce::OSCMessage(wheelAddresses[(size_t)(id % 8)],
+                                     ((float)id + 0.5f) / 16383.0f));
+  }
+
+  void sendMidiInNote() {
+    int id = midiInNotes.next();
+    engine.receiveMidi(
+        juce::MidiMessage::noteOn(9 + id / 128, id % 128, (juce::uint8)100));
+  }
+
+  void sendMidiInCC(int value) {
+    int id = midiInCCs.next();
+    engine.receiveMidi(
+        juce::MidiMessage::controllerEvent(9 + id / 128, id % 128, value));
+  }
+
+  // Scheduler thread, under the engine's output lock
+  void midiSink(const juce::MidiMessage &m) {
+    int ch = m.getChannel();
+    if (ch < 1 || ch > 8)
+      return; // MIDI input notes passing through
+    if (m.isNoteOn())
+      headsetNotes.received((ch - 1) * headsetNotesPerChannel +
+                            m.getNoteNumber() - 2);
+    else if (m.isPitchWheel())
+      headsetWheel.received(m.getPitchWheelValue());
+  }
+
+  // Peer receiver thread. The id is in the first message of each pair
+  // (note number, CC number); the value message after it is not tracked.
+  void oscMessageReceived(const juce::OSCMessage &m) override {
+    auto address = m.getAddressPattern().toString();
+    if (!address.startsWith("/ch") || m.size() == 0 || !m[0].isFloat32())
+      return;
+    int ch = address.substring(3).getIntValue();
+    auto suffix = address.substring(3 + juce::String(ch).length());
+    int number = (int)m[0].getFloat32();
+    if (ch < 9 || ch > 16)
+      return;
+    if (suffix == "note")
+      midiInNotes.received((ch - 9) * 128 + number);
+    else if (suffix == "cc")
+      midiInCCs.received((ch - 9) * 128 + number);
+  }
+
+  // Sends at the configured rates in 1 ms batches until time is up
+  template <typename NoteFn, typename CCFn>
+  void pace(NoteFn &&sendNote, CCFn &&sendCC) {
+    const double start = juce::Time::getMillisecondCounterHiRes();
+    juce::int64 notes = 0, ccs = 0;
+    for (;;) {
+      double elapsedMs = juce::Time::getMillisecondCounterHiRes() - start;
+      if (elapsedMs >= settings.seconds * 1000.0)
+        return;
+      for (auto due = (juce::int64)(elapsedMs * settings.noteRate / 1000.0);
+           notes < due; ++notes)
+        sendNote(notes);
+      for (auto due = (juce::int64)(elapsedMs * settings.ccRate / 1000.0);
+           ccs < due; ++ccs)
+        sendCC(ccs);
+      juce::Thread::sleep(1);
+    }
+  }
+
+  static int findFreePort() {
+    juce::DatagramSocket probe;
+    return probe.bindToPort(0, "127.0.0.1") ? probe.getBoundPort() : 0;
+  }
+
+  Settings settings;
+  LoopbackStream headsetNotes{"headset>MIDI note", 8 * headsetNotesPerChannel};
+  LoopbackStream headsetWheel{"headset>MIDI wheel", 16384};
+  LoopbackStream midiInNotes{"MIDI>headset note", 8 * 128};
+  LoopbackStream midiInCCs{"MIDI>headset CC", 8 * 128};
+
+  std::vector<juce::OSCAddressPattern> noteAddresses, wheelAddresses; // ch 1-8
+  juce::DatagramSocket peerSocket; // before the receiver reading from it
+  juce::OSCReceiver peerReceiver;
+  juce::OSCSender peerSender;
+  // Declared last so it is destroyed first: its threads call into the
+  // streams and the sink above
+  BridgeEngine engine;
+};
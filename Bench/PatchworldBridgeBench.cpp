@@ -0,0 +1,376 @@
+/*
+  ==============================================================================
+    Bench/PatchworldBridgeBench.cpp
+    Microbenchmarks for the OSC / MIDI routing hot paths
+  ==============================================================================
+*/
+#include "Core/BridgeEngine.h"
+#include "LoopbackBench.h"
+#include "Core/BridgeClock.h"
+#include "Core/ChannelMap.h"
+#include "Core/MidiTimeline.h"
+#include "Core/OscBundler.h"
+#include "Core/OscRouting.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <vector>
+
+// --- Allocation counting ---
+// Only the measuring thread's allocations count: Link, the OSC receiver and
+// the MIDI threads allocate on their own schedule and would add noise.
+namespace {
+thread_local juce::int64 allocationCount = 0;
+}
+
+void *operator new(std::size_t size) {
+  ++allocationCount;
+  if (auto *p = std::malloc(size > 0 ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+// Results feed into this so the optimiser can't drop the measured work
+volatile int sink = 0;
+
+struct Benchmark {
+  const char *name;
+  std::function<int(int iterations)> run; // returns a checksum
+};
+
+// Doubles the iteration count until one run takes at least minMs, after a
+// warm-up run that also fills any lazily built caches
+void measure(const Benchmark &b, double minMs) {
+  using Clock = std::chrono::steady_clock;
+  sink = sink + b.run(1000);
+  for (int iterations = 1000;; iterations *= 2) {
+    auto allocationsBefore = allocationCount;
+    auto start = Clock::now();
+    sink = sink + b.run(iterations);
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    auto allocations = allocationCount - allocationsBefore;
+    if (elapsed.count() >= minMs || iterations >= (1 << 28)) {
+      std::printf("%-28s %10.1f ns/op %8.2f allocs/op\n", b.name,
+                  elapsed.count() * 1.0e6 / iterations,
+                  (double)allocations / iterations);
+      return;
+    }
+  }
+}
+
+// Mixer channel names as a fresh install has them ("1".."16")
+const juce::StringArray &channelNames() {
+  static const juce::StringArray names = [] {
+    juce::StringArray n;
+    for (int ch = 1; ch <= 16; ++ch)
+      n.add(juce::String(ch));
+    return n;
+  }();
+  return names;
+}
+
+// What a headset sends while a few players are on: mostly notes, some
+// wheel, and addresses the bridge doesn't handle
+std::vector<juce::OSCMessage> makeIncomingTraffic() {
+  std::vector<juce::OSCMessage> traffic;
+  juce::Random random(1);
+  for (int i = 0; i < 256; ++i) {
+    auto ch = juce::String(1 + random.nextInt(16));
+    auto note = (float)(36 + random.nextInt(48));
+    switch (random.nextInt(10)) {
+    case 0:
+      traffic.emplace_back(juce::OSCAddressPattern("/ch" + ch + "wheel"),
+                           random.nextFloat());
+      break;
+    case 1:
+      traffic.emplace_back(juce::OSCAddressPattern("/ch" + ch + "cv"),
+                           random.nextFloat());
+      break;
+    case 2:
+    case 3:
+    case 4:
+      traffic.emplace_back(juce::OSCAddressPattern("/ch" + ch + "noff"), note);
+      break;
+    default:
+      traffic.emplace_back(juce::OSCAddressPattern("/ch" + ch + "n"), note,
+                           random.nextFloat());
+      break;
+    }
+  }
+  return traffic;
+}
+
+// Note on/off pairs and a controller sweep on every channel
+std::vector<juce::MidiMessage> makeOutgoingMidi() {
+  std::vector<juce::MidiMessage> midi;
+  juce::Random random(2);
+  for (int i = 0; i < 256; ++i) {
+    int ch = 1 + random.nextInt(16), note = 36 + random.nextInt(48);
+    if (i % 8 == 7)
+      midi.push_back(juce::MidiMessage::controllerEvent(ch, 74, i % 128));
+    else if (i % 2 == 0)
+      midi.push_back(juce::MidiMessage::noteOn(ch, note, (juce::uint8)100));
+    else
+      midi.push_back(juce::MidiMessage::noteOff(ch, note));
+  }
+  return midi;
+}
+
+// 16 tracks of sixteenth notes with a CC every beat, 64 bars
+MidiTimeline makeTimeline() {
+  juce::MidiMessageSequence seq;
+  const double tpq = 960.0;
+  for (int ch = 1; ch <= 16; ++ch)
+    for (int step = 0; step < 64 * 16; ++step) {
+      double tick = step * tpq / 4.0;
+      int note = 36 + (step * 7 + ch * 5) % 48;
+      seq.addEvent(juce::MidiMessage::noteOn(ch, note, (juce::uint8)90), tick);
+      seq.addEvent(juce::MidiMessage::noteOff(ch, note), tick + tpq / 8.0);
+      if (step % 4 == 0)
+        seq.addEvent(juce::MidiMessage::controllerEvent(ch, 1, step % 128),
+                     tick);
+    }
+  seq.sort();
+  return MidiTimeline::compile(seq, tpq);
+}
+
+// Mixer with strips reordered and a few channels muted
+void setMixerLayout(ChannelMap &map) {
+  std::array<int, 16> order{3,  1,  2,  4,  8,  7,  6,  5,
+                            9, 10, 12, 11, 13, 16, 15, 14};
+  map.set(order, 0xffffu & ~((1u << 4) | (1u << 9)));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  juce::ScopedJuceInitialiser_GUI juceInit;
+  juce::String filter;
+  double minMs = 200.0;
+  bool loopback = false;
+  LoopbackBench::Settings loopbackSettings;
+  for (int i = 1; i < argc; ++i) {
+    juce::String arg(argv[i]);
+    auto value = [&] { return juce::String(i + 1 < argc ? argv[++i] : ""); };
+    if (arg == "--min-ms")
+      minMs = value().getDoubleValue();
+    else if (arg == "--loopback")
+      loopback = true;
+    else if (arg == "--notes")
+      loopbackSettings.noteRate = value().getIntValue();
+    else if (arg == "--cc")
+      loopbackSettings.ccRate = value().getIntValue();
+    else if (arg == "--seconds")
+      loopbackSettings.seconds = value().getDoubleValue();
+    else if (arg == "--bundle")
+      loopbackSettings.bundle = true;
+    else if (arg == "--help") {
+      std::printf(
+          "Usage: PatchworldBridgeBench [--min-ms <ms>] [filter]\n"
+          "       PatchworldBridgeBench --loopback [--notes <per second>]\n"
+          "           [--cc <per second>] [--seconds <s>] [--bundle]\n");
+      return 0;
+    } else
+      filter = arg;
+  }
+
+  if (loopback) {
+    LoopbackBench bench(loopbackSettings);
+    return bench.run();
+  }
+
+  // Outgoing traffic goes to a bound socket nobody reads; the kernel drops
+  // what doesn't fit in its buffer, which is fine for timing the send side
+  juce::DatagramSocket oscSink;
+  oscSink.bindToPort(0, "127.0.0.1");
+  const int sinkPort = oscSink.getBoundPort();
+
+  const OscAddresses addresses;
+  const auto dispatch = OscDispatchTable::build(addresses);
+  const OscAddressCache txCache(addresses.tx, channelNames());
+  const auto incoming = makeIncomingTraffic();
+  const auto outgoing = makeOutgoingMidi();
+  const auto timeline = makeTimeline();
+  ChannelMap channelMap;
+  setMixerLayout(channelMap);
+
+  juce::OSCSender sender;
+  sender.connect("127.0.0.1", sinkPort);
+  OscBundler bundler(sender);
+  bundler.setEnabled(true);
+
+  BridgeEngine engine;
+  engine.setProbeSettings(0, false);
+  engine.setOscBundling(true, 1400);
+  engine.connectOsc("127.0.0.1", sinkPort, 0);
+  {
+    std::array<int, 16> order;
+    for (int ch = 1; ch <= 16; ++ch)
+      order[(size_t)ch - 1] = channelMap.map(ch);
+    engine.setChannelMap(order, channelMap.getActiveMask());
+  }
+
+  // A second engine playing the timeline on a virtual clock, ticked back
+  // to back, with the same layout plus an octave shift and split. Its OSC
+  // and MIDI go to sinks that only count.
+  VirtualClock playbackClock(ableton::Link::Clock().micros());
+  BridgeEngine player; // after the clock it reads
+  int emitted = 0;
+  {
+    BridgeConfig config;
+    config.link = false;
+    config.probeMs = 0;
+    config.loop = true;
+    config.octave = 1;
+    config.split = true;
+    for (int ch = 1; ch <= 16; ++ch)
+      config.channelMap[(size_t)ch - 1] = channelMap.map(ch);
+    config.activeChannels = channelMap.getActiveMask();
+    player.setClock(&playbackClock);
+    player.setKeyboardEchoes(false);
+    player.setTrafficLogging(false);
+    player.applyConfig(config);
+    player.setOscSink([&emitted](const juce::OSCMessage &) { ++emitted; });
+    player.onMidiOut = [&emitted](const juce::MidiMessage &) { ++emitted; };
+    auto file = std::make_shared<LoadedMidiFile>();
+    file->timeline = timeline;
+    player.setFile(std::move(file));
+    player.runSchedulerTick(); // stopped: the file goes live right away
+    player.togglePlay();
+  }
+
+  const size_t mask = 255; // traffic vectors hold 256 entries
+  std::vector<Benchmark> benchmarks{
+      // Address -> (action, channel), as the OSC receiver thread does it
+      {"rx.dispatch",
+       [&](int n) {
+         int sum = 0;
+         for (int i = 0; i < n; ++i) {
+           auto &m = incoming[(size_t)i & mask];
+           sum += dispatch->find(m.getAddressPattern().toString()).channel;
+         }
+         return sum;
+       }},
+      // Address plus argument extraction, before routing starts
+      {"rx.decode",
+       [&](int n) {
+         int sum = 0;
+         for (int i = 0; i < n; ++i) {
+           auto &m = incoming[(size_t)i & mask];
+           auto route = dispatch->find(m.getAddressPattern().toString());
+           float val = (m.size() > 0 && m[0].isFloat32()) ? m[0].getFloat32()
+                                                           : 0.0f;
+           float vel = (m.size() > 1 && m[1].isFloat32()) ? m[1].getFloat32()
+                                                           : 0.0f;
+           sum += route.channel + (int)(val + vel);
+         }
+         return sum;
+       }},
+      // Cached address pattern + message, what the send path builds
+      {"tx.address",
+       [&](int n) {
+         int sum = 0;
+         for (int i = 0; i < n; ++i) {
+           int ch = 1 + (i & 15);
+           if (auto *addr = txCache.get(ch, OscAddressCache::NoteOn)) {
+             juce::OSCMessage m(*addr, (float)(i & 127));
+             sum += m.size();
+           }
+         }
+         return sum;
+       }},
+      // The same built from the template per message, for comparison
+      {"tx.addressFromTemplate",
+       [&](int n) {
+         int sum = 0;
+         for (int i = 0; i < n; ++i) {
+           auto addr = addresses.tx[OscAddressCache::NoteOn].replace(
+               "{X}", channelNames()[i & 15]);
+           juce::OSCMessage m(juce::OSCAddressPattern(addr),
+                              (float)(i & 127));
+           sum += m.size();
+         }
+         return sum;
+       }},
+      {"osc.encodedSize",
+       [&](int n) {
+         int sum = 0;
+         for (int i = 0; i < n; ++i)
+           sum += OscBundler::estimateMessageSize(incoming[(size_t)i & mask]);
+         return sum;
+       }},
+      // Encode + one datagram per message
+      {"osc.send",
+       [&](int n) {
+         int sum = 0;
+         for (int i = 0; i < n; ++i)
+           sum += sender.send(incoming[(size_t)i & mask]) ? 1 : 0;
+         return sum;
+       }},
+      // Encode into bundles of up to 1400 bytes, flushed when full
+      {"osc.sendBundled",
+       [&](int n) {
+         int sum = 0;
+         for (int i = 0; i < n; ++i)
+           sum += bundler.send(incoming[(size_t)i & mask]) ? 1 : 0;
+         bundler.flush();
+         return sum;
+       }},
+      {"mixer.map",
+       [&](int n) {
+         int sum = 0;
+         for (int i = 0; i < n; ++i) {
+           int ch = channelMap.map(1 + (i & 15));
+           sum += channelMap.isActive(ch) ? ch : 0;
+         }
+         return sum;
+       }},
+      // MIDI -> OSC through the engine: channel map, address cache, bundler
+      {"route.midiToOsc",
+       [&](int n) {
+         engine.setSplitEnabled(false);
+         for (int i = 0; i < n; ++i)
+           engine.sendSplitOscMessage(outgoing[(size_t)i & mask]);
+         return n;
+       }},
+      {"route.midiToOscSplit",
+       [&](int n) {
+         engine.setSplitEnabled(true);
+         for (int i = 0; i < n; ++i)
+           engine.sendSplitOscMessage(outgoing[(size_t)i & mask], 1);
+         engine.setSplitEnabled(false);
+         return n;
+       }},
+      // The engine's own playback loop per message sent: timeline walk,
+      // octave shift, channel map, split, mutes, OSC and MIDI out
+      {"playback.loop",
+       [&](int n) {
+         const int target = emitted + n;
+         int ticks = 0;
+         for (; emitted < target; ++ticks) {
+           playbackClock.advance(std::chrono::milliseconds(1));
+           player.runSchedulerTick();
+         }
+         return ticks;
+       }},
+  };
+
+  std::printf("%d timeline events, %d RX routes\n\n", timeline.size(),
+              dispatch->size());
+  for (auto &b : benchmarks)
+    if (filter.isEmpty() || juce::String(b.name).contains(filter))
+      measure(b, minMs);
+
+  player.shutdown();
+  engine.shutdown();
+  return 0;
+}
@@ -40,6 +40,22 @@ public:
       lArpS{{}, "Arp Spd:"}, lArpV{{}, "Arp Vel:"};
   juce::TextEditor eMixVol, eMixMute, eArpS, eArpV;
 
+  // TX Transport
+  juce::ToggleButton btnBundle{"Bundle TX per tick"};
+  juce::Label lMaxBundle{{}, "Max Bytes:"};
+  juce::TextEditor eMaxBundle;
+
+  // Round-trip probe to the OSC target
+  juce::Label lProbe{{}, "Probe ms:"};
+  juce::TextEditor eProbeMs;
+  juce::ToggleButton btnAnswerPings{"Answer pings"};
+
+  // Fired whenever any address field is edited (used to recompile the
+  // dispatch table instead of re-reading the editors per packet)
+  std::function<void()> onAddressChanged;
+  std::function<void(bool, int)> onBundleSettingsChanged;
+  std::function<void(int, bool)> onProbeSettingsChanged; // interval, respond
+
   OscAddressConfig() {
     addAndMakeVisible(lblTitle);
     lblTitle.setFont(juce::FontOptions(16.0f).withStyle("Bold"));
@@ -54,6 +70,34 @@ public:
     setup(lTXpr, eTXpr, "/ch{X}pressure");
     setup(lTXpoly, eTXpoly, "/ch{X}pressure"); // Default TX Poly
 
+    addAndMakeVisible(btnBundle);
+    addAndMakeVisible(lMaxBundle);
+    addAndMakeVisible(eMaxBundle);
+    eMaxBundle.setText("1400");
+    eMaxBundle.setInputRestrictions(5, "0123456789");
+    auto bundleChanged = [this] {
+      if (onBundleSettingsChanged)
+        onBundleSettingsChanged(btnBundle.getToggleState(),
+                                eMaxBundle.getText().getIntValue());
+    };
+    btnBundle.onClick = bundleChanged;
+    eMaxBundle.onTextChange = bundleChanged;
+
+    addAndMakeVisible(lProbe);
+    addAndMakeVisible(eProbeMs);
+    addAndMakeVisible(btnAnswerPings);
+    eProbeMs.setText("1000");
+    eProbeMs.setInputRestrictions(5, "0123456789");
+    eProbeMs.setTooltip("Ping interval to the OSC target, 0 = off");
+    btnAnswerPings.setTooltip("Reply to /pwb/ping from the other end");
+    auto probeChanged = [this] {
+      if (onProbeSettingsChanged)
+        onProbeSettingsChanged(eProbeMs.getText().getIntValue(),
+                               btnAnswerPings.getToggleState());
+    };
+    eProbeMs.onTextChange = probeChanged;
+    btnAnswerPings.onClick = probeChanged;
+
     // RX Addresses
     setup(lRXn, eRXn, "/ch{X}n");
     setup(lRXnv, eRXnv, "/ch{X}nv");
@@ -85,13 +129,17 @@ public:
     addAndMakeVisible(eVol2);
     eVol2.setText("/ch2/vol");
 
-    setSize(450, 950);
+    setSize(450, 1020);
   }
 
   void setup(juce::Label &l, juce::TextEditor &e, juce::String def) {
     addAndMakeVisible(l);
     addAndMakeVisible(e);
     e.setText(def);
+    e.onTextChange = [this] {
+      if (onAddressChanged)
+        onAddressChanged();
+    };
   }
 
   void paint(juce::Graphics &g) override {
@@ -120,6 +168,19 @@ public:
     addRow(lTXpr, eTXpr);
     addRow(lTXpoly, eTXpoly); // Added
 
+    auto bundleRow = r.removeFromTop(25);
+    btnBundle.setBounds(bundleRow.removeFromLeft(170));
+    lMaxBundle.setBounds(bundleRow.removeFromLeft(75));
+    eMaxBundle.setBounds(bundleRow.removeFromLeft(60));
+    r.removeFromTop(5);
+
+    auto probeRow = r.removeFromTop(25);
+    lProbe.setBounds(probeRow.removeFromLeft(70));
+    eProbeMs.setBounds(probeRow.removeFromLeft(60));
+    probeRow.removeFromLeft(10);
+    btnAnswerPings.setBounds(probeRow.removeFromLeft(130));
+    r.removeFromTop(5);
+
     r.removeFromTop(10);
 
     addRow(lRXn, eRXn);
@@ -124,6 +124,7 @@ public:
   juce::OwnedArray<MixerStrip> strips;
   std::function<void(int, float)> onMixerActivity;
   std::function<void(int, bool)> onChannelToggle;
+  std::function<void()> onChannelNamesChanged;
   const int stripWidth = 60;
 
   MixerContainer() {
@@ -137,14 +138,18 @@ public:
           onMixerActivity(ch, val);
       };
       s->onActiveChange = [this](int ch, bool active) {
+        refreshActiveMask();
         if (onChannelToggle)
           onChannelToggle(ch, active);
       };
       addAndMakeVisible(s);
     }
+    refreshActiveMask();
   }
 
-  int getMappedChannel(int sourceCh) {
+  // Message thread. Routing threads read the engine's ChannelMap, which
+  // MainComponent::pushChannelMap fills from these.
+  int getMappedChannel(int sourceCh) const {
     if (sourceCh < 1 || sourceCh > 16)
       return sourceCh;
     return channelMapping[sourceCh - 1] + 1;
@@ -160,22 +165,25 @@ public:
         strips[i]->visualIndex = i;
         channelMapping[strips[i]->channelIndex] = i;
       }
+      refreshActiveMask();
       for (int i = 0; i < strips.size(); ++i) {
         if (strips[i]->nameLabel.getText().containsOnly("0123456789")) {
           strips[i]->nameLabel.setText(juce::String(i + 1),
                                        juce::dontSendNotification);
         }
       }
+      if (onChannelNamesChanged)
+        onChannelNamesChanged();
       resized();
       if (auto *p = getParentComponent())
         p->repaint();
     }
   }
 
-  bool isChannelActive(int ch) {
-    if (isPositiveAndBelow(ch - 1, strips.size()))
-      return strips[ch - 1]->btnActive.getToggleState();
-    return true;
+  bool isChannelActive(int ch) const {
+    if (ch < 1 || ch > 16)
+      return true;
+    return (activeMask >> (ch - 1)) & 1u;
   }
 
   juce::String getChannelName(int ch) {
@@ -195,11 +203,15 @@ public:
           onMixerActivity(ch, val);
       };
       s->onActiveChange = [this](int ch, bool active) {
+        refreshActiveMask();
         if (onChannelToggle)
           onChannelToggle(ch, active);
       };
       addAndMakeVisible(s);
     }
+    refreshActiveMask();
+    if (onChannelNamesChanged)
+      onChannelNamesChanged();
     resized();
   }
 
@@ -211,5 +223,16 @@ public:
   }
 
 private:
+  // Bit n set = strip at position n + 1 is switched on. Rebuilt on the
+  // message thread whenever a toggle changes or strips move.
+  void refreshActiveMask() {
+    juce::uint32 mask = 0xffff;
+    for (int i = 0; i < juce::jmin(16, strips.size()); ++i)
+      if (!strips[i]->btnActive.getToggleState())
+        mask &= ~(1u << i);
+    activeMask = mask;
+  }
+
   int channelMapping[16];
+  juce::uint32 activeMask = 0xffff;
 };
@@ -0,0 +1,256 @@
+/*
+  ==============================================================================
+    Source/Components/PianoRollRenderer.h
+    Instanced OpenGL note drawing for ComplexPianoRoll
+  ==============================================================================
+*/
+#pragma once
+#include "../Core/MidiFileLoader.h"
+#include "Common.h"
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <memory>
+
+// Draws the piano roll's notes as one instanced quad per note. The instance
+// buffer is uploaded once per loaded file; per frame only the cursor, the
+// octave shift and the key edge table go up as uniforms. Set as the renderer
+// of the OpenGLContext attached to the piano roll's parent, and draws into
+// the roll's notes area underneath the parent's software painting (which
+// leaves that area transparent while isDrawing() is true).
+class PianoRollRenderer : public juce::OpenGLRenderer {
+public:
+  PianoRollRenderer(const std::atomic<float> &cursorTicks,
+                    const std::atomic<int> &octaveShift)
+      : cursor(cursorTicks), octave(octaveShift) {}
+
+  // --- Message thread ---
+  void setNotes(std::shared_ptr<const LoadedMidiFile> file) {
+    std::atomic_store(&notesFile, std::move(file));
+  }
+
+  // area: notes area in the parent's coordinates. keyEdges: 129 x positions
+  // relative to the area's left edge.
+  void setLayout(juce::Rectangle<int> area,
+                 const std::array<float, 129> &keyEdges, float pxPerTick) {
+    const juce::SpinLock::ScopedLockType sl(layoutLock);
+    layout.area = area;
+    layout.keyEdges = keyEdges;
+    layout.pxPerTick = pxPerTick;
+  }
+
+  // True while a context is live and the shaders built
+  bool isDrawing() const { return ready; }
+
+  // --- GL thread ---
+  void newOpenGLContextCreated() override {
+    using namespace juce::gl;
+    auto *context = juce::OpenGLContext::getCurrentContext();
+    if (context == nullptr)
+      return;
+
+    program = std::make_unique<juce::OpenGLShaderProgram>(*context);
+    if (!program->addVertexShader(vertexShader) ||
+        !program->addFragmentShader(fragmentShader) || !program->link()) {
+      DBG("Piano roll shaders: " << program->getLastError());
+      program.reset();
+      return;
+    }
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &cornerVbo);
+    glGenBuffers(1, &instanceVbo);
+
+    GLint previousVao = 0;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+    glBindVertexArray(vao);
+
+    const GLfloat corners[] = {0, 0, 1, 0, 0, 1, 1, 1};
+    glBindBuffer(GL_ARRAY_BUFFER, cornerVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    auto id = program->getProgramID();
+    auto aCorner = (GLuint)glGetAttribLocation(id, "aCorner");
+    glEnableVertexAttribArray(aCorner);
+    glVertexAttribPointer(aCorner, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    auto aNote = (GLuint)glGetAttribLocation(id, "aNote");
+    auto aColour = (GLuint)glGetAttribLocation(id, "aColour");
+    glEnableVertexAttribArray(aNote);
+    glVertexAttribPointer(aNote, 3, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                          (void *)offsetof(Instance, key));
+    glVertexAttribDivisor(aNote, 1);
+    glEnableVertexAttribArray(aColour);
+    glVertexAttribPointer(aColour, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                          sizeof(Instance), (void *)offsetof(Instance, rgba));
+    glVertexAttribDivisor(aColour, 1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray((GLuint)previousVao);
+
+    uploadedFile.reset();
+    numInstances = 0;
+    ready = true;
+  }
+
+  void renderOpenGL() override {
+    using namespace juce::gl;
+    if (!ready)
+      return;
+
+    Layout l;
+    {
+      const juce::SpinLock::ScopedLockType sl(layoutLock);
+      l = layout;
+    }
+    if (l.area.isEmpty())
+      return;
+
+    auto file = std::atomic_load(&notesFile);
+    if (file != uploadedFile)
+      upload(file);
+
+    // Parent coordinates (top-left origin) -> framebuffer (bottom-left).
+    // JUCE sets the viewport to the whole target before every frame, so
+    // its height is the parent's current one, even mid-resize.
+    GLint previousVao = 0, previousViewport[4] = {};
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    auto scale = (float)juce::OpenGLContext::getCurrentContext()
+                     ->getRenderingScale();
+    auto px = l.area.toFloat() * scale;
+    auto vx = juce::roundToInt(px.getX());
+    auto vy = juce::roundToInt((float)previousViewport[3] - px.getBottom());
+    auto vw = juce::roundToInt(px.getWidth());
+    auto vh = juce::roundToInt(px.getHeight());
+
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(vx, vy, vw, vh);
+    juce::OpenGLHelpers::clear(Theme::bgDark);
+    glDisable(GL_SCISSOR_TEST);
+    if (numInstances == 0)
+      return;
+
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+    glViewport(vx, vy, vw, vh);
+    glDisable(GL_BLEND);
+
+    program->use();
+    auto id = program->getProgramID();
+    glUniform1fv(glGetUniformLocation(id, "uKeyX"), 129, l.keyEdges.data());
+    glUniform1f(glGetUniformLocation(id, "uOctave"), 12.0f * octave.load());
+    glUniform1f(glGetUniformLocation(id, "uCursor"), cursor.load());
+    glUniform1f(glGetUniformLocation(id, "uPxPerTick"), l.pxPerTick);
+    glUniform2f(glGetUniformLocation(id, "uSize"), (float)l.area.getWidth(),
+                (float)l.area.getHeight());
+
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, numInstances);
+    glBindVertexArray((GLuint)previousVao);
+    glUseProgram(0);
+
+    // JUCE composites the component layer next, over the whole target
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2],
+               previousViewport[3]);
+  }
+
+  void openGLContextClosing() override {
+    using namespace juce::gl;
+    ready = false;
+    if (vao != 0)
+      glDeleteVertexArrays(1, &vao);
+    if (cornerVbo != 0)
+      glDeleteBuffers(1, &cornerVbo);
+    if (instanceVbo != 0)
+      glDeleteBuffers(1, &instanceVbo);
+    vao = cornerVbo = instanceVbo = 0;
+    program.reset();
+    uploadedFile.reset();
+    numInstances = 0;
+  }
+
+private:
+  struct Instance {
+    float key, start, end; // note number, ticks
+    juce::uint8 rgba[4];
+  };
+
+  struct Layout {
+    juce::Rectangle<int> area;
+    std::array<float, 129> keyEdges{};
+    float pxPerTick = 10.0f / 480.0f;
+  };
+
+  void upload(const std::shared_ptr<const LoadedMidiFile> &file) {
+    using namespace juce::gl;
+    uploadedFile = file;
+    numInstances = 0;
+    if (file == nullptr)
+      return;
+
+    const auto &notes = file->notes.getNotes();
+    std::vector<Instance> instances;
+    instances.reserve(notes.size());
+    for (auto &n : notes) {
+      auto c = Theme::getChannelColor(n.channel);
+      instances.push_back({(float)n.note, (float)n.start, (float)n.end,
+                           {c.getRed(), c.getGreen(), c.getBlue(), 255}});
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER,
+                 (GLsizeiptr)(instances.size() * sizeof(Instance)),
+                 instances.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    numInstances = (GLsizei)instances.size();
+  }
+
+  // Same geometry as the software path: key edges from the table, y from
+  // the tick distance to the cursor at the bottom of the area
+  static constexpr const char *vertexShader = R"(
+    #version 150
+    in vec2 aCorner;
+    in vec3 aNote; // key, start tick, end tick
+    in vec4 aColour;
+    uniform float uKeyX[129];
+    uniform float uOctave;
+    uniform float uCursor;
+    uniform float uPxPerTick;
+    uniform vec2 uSize;
+    out vec4 vColour;
+    void main() {
+      float key = aNote.x + uOctave;
+      if (key < 0.0 || key > 127.0) {
+        gl_Position = vec4(2.0, 2.0, 0.0, 1.0); // culled
+        vColour = vec4(0.0);
+        return;
+      }
+      int k = int(key);
+      float x = uKeyX[k] + 1.0;
+      float w = max(2.0, uKeyX[k + 1] - uKeyX[k] - 1.0);
+      float yTop = uSize.y - (aNote.z - uCursor) * uPxPerTick;
+      float yBottom = uSize.y - (aNote.y - uCursor) * uPxPerTick;
+      vec2 p = vec2(x + aCorner.x * w, mix(yTop, yBottom, aCorner.y));
+      gl_Position = vec4(p.x / uSize.x * 2.0 - 1.0,
+                         1.0 - p.y / uSize.y * 2.0, 0.0, 1.0);
+      vColour = aColour;
+    })";
+
+  static constexpr const char *fragmentShader = R"(
+    #version 150
+    in vec4 vColour;
+    out vec4 fragColour;
+    void main() { fragColour = vColour; })";
+
+  const std::atomic<float> &cursor;
+  const std::atomic<int> &octave;
+
+  juce::SpinLock layoutLock;
+  Layout layout;
+  std::shared_ptr<const LoadedMidiFile> notesFile; // atomic access only
+
+  // GL thread only
+  std::unique_ptr<juce::OpenGLShaderProgram> program;
+  juce::gl::GLuint vao = 0, cornerVbo = 0, instanceVbo = 0;
+  std::shared_ptr<const LoadedMidiFile> uploadedFile;
+  juce::gl::GLsizei numInstances = 0;
+  std::atomic<bool> ready{false};
+};
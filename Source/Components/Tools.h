@@ -5,58 +5,38 @@
   ==============================================================================
 */
 #pragma once
+#include "../Core/EventLog.h"
+#include "../Core/LogRing.h"
 #include "Common.h"
 #include <JuceHeader.h>
 #include <atomic>
-
-class PingWorker : public juce::Thread {
-public:
-  std::atomic<int> lastPingMs{-1};
-  PingWorker() : juce::Thread("PingThread") { startThread(); }
-  ~PingWorker() { stopThread(2000); }
-
-  void run() override {
-    while (!threadShouldExit()) {
-      lastPingMs = runPing();
-      wait(5000);
-    }
-  }
-
-  int runPing() {
-    juce::ChildProcess proc;
-    juce::String cmd;
-#if JUCE_WINDOWS
-    cmd = "ping -n 1 8.8.8.8";
-#else
-    cmd = "ping -c 1 8.8.8.8";
-#endif
-    if (proc.start(cmd)) {
-      juce::String output = proc.readAllProcessOutput();
-      // Parse "time=XXms" or "time=XX ms"
-      // Windows: "time=12ms"
-      // Linux: "time=12.3 ms"
-      int idx = output.indexOf("time=");
-      if (idx > 0) {
-        juce::String sub = output.substring(idx + 5);
-        int msIdx = sub.indexOf("ms");
-        if (msIdx > 0) {
-          return sub.substring(0, msIdx).getFloatValue();
-        }
-      }
-    }
-    return -1;
-  }
-};
-
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Every thread logs by pushing a 64-byte LogEvent into a lock-free ring.
+// The 100 ms timer moves new records into an in-memory history (kept for
+// Export) and formats only the ones that will actually be on screen,
+// appending them and trimming the oldest lines from the top so the display
+// never re-lays out the whole log.
 class TrafficMonitor : public juce::Component, public juce::Timer {
 public:
+  static constexpr int maxVisibleLines = 100;
+  static constexpr int historySize = 16384;
+
   juce::TextEditor logDisplay;
   juce::Label statsLabel;
   juce::ToggleButton btnPause{"Pause"};
   juce::TextButton btnClear{"Clear"};
-  juce::StringArray messageBuffer;
-  int visibleLines = 0;
-  PingWorker pingWorker;
+  juce::TextButton btnExport{"Export"};
+  juce::ToggleButton btnCapture{"Capture"};
+  juce::TextButton btnReplay{"Replay"};
+
+  // Capture to disk and replay live in MainComponent, next to the traffic
+  std::function<void(bool)> onCaptureChanged;
+  std::function<void()> onReplay;
+  std::function<juce::String()> getLatencyJson; // for Export
 
   TrafficMonitor() {
     statsLabel.setFont(juce::FontOptions(12.0f));
@@ -67,11 +47,32 @@ public:
     addAndMakeVisible(statsLabel);
 
     btnPause.setToggleState(false, juce::dontSendNotification);
+    btnPause.onClick = [this] { paused = btnPause.getToggleState(); };
     addAndMakeVisible(btnPause);
 
     btnClear.onClick = [this] { resetStats(); };
     addAndMakeVisible(btnClear);
 
+    btnExport.setTooltip("Save the traffic log (last " +
+                         juce::String(historySize) +
+                         " records) or the latency histograms");
+    btnExport.onClick = [this] { showExportMenu(); };
+    addAndMakeVisible(btnExport);
+
+    btnCapture.setTooltip("Stream all OSC/MIDI traffic to a capture file");
+    btnCapture.onClick = [this] {
+      if (onCaptureChanged)
+        onCaptureChanged(btnCapture.getToggleState());
+    };
+    addAndMakeVisible(btnCapture);
+
+    btnReplay.setTooltip("Play a capture's inputs back through the bridge");
+    btnReplay.onClick = [this] {
+      if (onReplay)
+        onReplay();
+    };
+    addAndMakeVisible(btnReplay);
+
     logDisplay.setMultiLine(true);
     logDisplay.setReadOnly(true);
     logDisplay.setFont(juce::FontOptions(13.0f));
@@ -79,62 +80,181 @@ public:
     logDisplay.setColour(juce::TextEditor::outlineColourId, Theme::grid);
     addAndMakeVisible(logDisplay);
 
+    history.resize((size_t)historySize);
+    historyText.resize((size_t)historySize);
     startTimer(100);
   }
 
+  // Status lines from the UI. Safe from any thread, never blocks.
   void log(const juce::String &msg, bool alwaysShow = false) {
-    if (btnPause.getToggleState() && !alwaysShow)
+    if (paused && !alwaysShow)
       return;
-    juce::ScopedLock sl(logLock);
-    // CHANGED: Use "!" instead of time
-    messageBuffer.add("! " + msg);
-    if (messageBuffer.size() > 100)
-      messageBuffer.remove(0);
-    visibleLines++;
+    LogEvent::pushText(msg.toRawUTF8(),
+                       [this](const LogEvent &e) { ring.push(e); });
+  }
+
+  // Hot paths: no formatting, no allocation
+  void logEvent(const LogEvent &e, bool alwaysShow = false) {
+    if (!paused || alwaysShow)
+      ring.push(e);
   }
 
+  // The engine's stats plus records this panel's ring lost to overruns
   void updateStats(const juce::String &text) {
-    juce::String sysLat = (getSystemLatency() >= 0)
-                              ? (juce::String(getSystemLatency()) + "ms")
-                              : "--";
-    // Append System Ping to the Link text passed in
-    statsLabel.setText(text + " | IPv4 Latency: " + sysLat,
+    statsLabel.setText(text + " | Log Dropped: " +
+                           juce::String(ring.getDropped()),
                        juce::dontSendNotification);
   }
 
   void resetStats() {
-    juce::ScopedLock sl(logLock);
-    messageBuffer.clear();
+    ring.skipAll();
     logDisplay.clear();
-    visibleLines = 0;
+    lineLengths.clear();
+    historyCount = 0;
   }
 
-  // Custom method to poll ping
-  int getSystemLatency() { return pingWorker.lastPingMs; }
-
   void timerCallback() override {
-    if (visibleLines > 0) {
-      juce::ScopedLock sl(logLock);
-      juce::String text;
-      for (auto &m : messageBuffer)
-        text += m + "\n";
-      logDisplay.setText(text);
-      logDisplay.moveCaretToEnd();
-      visibleLines = 0;
+    int numNew = 0;
+    ring.drain([&](const LogEvent &e) {
+      juce::String line;
+      if (e.kind == LogEvent::Text && !textJoiner.add(e, line))
+        return; // more of the line to come
+      history[(size_t)historyNext] = e;
+      historyText[(size_t)historyNext] = std::move(line);
+      historyNext = (historyNext + 1) % historySize;
+      historyCount = juce::jmin(historyCount + 1, historySize);
+      ++numNew;
+    });
+    if (numNew == 0)
+      return;
+
+    // Records that would scroll straight out again are never formatted
+    int numShown = juce::jmin(numNew, maxVisibleLines, historyCount);
+    juce::String added;
+    for (int i = numShown; i > 0; --i) {
+      auto line = displayAt(historyCount - i) + "\n";
+      lineLengths.push_back(line.length());
+      added += line;
+    }
+
+    int trimmedChars = 0;
+    while ((int)lineLengths.size() > maxVisibleLines) {
+      trimmedChars += lineLengths.front();
+      lineLengths.pop_front();
     }
+    int shownChars = logDisplay.getTotalNumChars();
+    if (trimmedChars > shownChars)
+      added = added.substring(trimmedChars - shownChars);
+    trimmedChars = juce::jmin(trimmedChars, shownChars);
+
+    if (trimmedChars > 0) {
+      logDisplay.setHighlightedRegion({0, trimmedChars});
+      logDisplay.insertTextAtCaret({});
+    }
+    logDisplay.moveCaretToEnd();
+    logDisplay.insertTextAtCaret(added);
   }
 
   void resized() override {
     auto r = getLocalBounds();
     auto top = r.removeFromTop(25);
-    statsLabel.setBounds(top.removeFromLeft(top.getWidth() - 120));
+    statsLabel.setBounds(top.removeFromLeft(top.getWidth() - 310));
     btnPause.setBounds(top.removeFromLeft(60).reduced(2));
     btnClear.setBounds(top.removeFromLeft(60).reduced(2));
+    btnExport.setBounds(top.removeFromLeft(60).reduced(2));
+    btnCapture.setBounds(top.removeFromLeft(70).reduced(2));
+    btnReplay.setBounds(top.removeFromLeft(60).reduced(2));
     logDisplay.setBounds(r);
   }
 
 private:
-  juce::CriticalSection logLock;
+  // i = 0 is the oldest record still held
+  size_t historyIndex(int i) const {
+    return (size_t)((historyNext - historyCount + i + historySize) %
+                    historySize);
+  }
+
+  // Text records are shown as the whole line they ended
+  juce::String displayAt(int i) const {
+    auto &e = history[historyIndex(i)];
+    return e.kind == LogEvent::Text
+               ? e.toDisplayString(historyText[historyIndex(i)])
+               : e.toDisplayString();
+  }
+
+  juce::String exportAt(int i) const {
+    auto &e = history[historyIndex(i)];
+    return e.kind == LogEvent::Text
+               ? e.toExportString(historyText[historyIndex(i)])
+               : e.toExportString();
+  }
+
+  void showExportMenu() {
+    juce::PopupMenu menu;
+    menu.addItem("Traffic log (.tsv)", [this] { exportHistory(); });
+    menu.addItem("Latency histograms (.json)", getLatencyJson != nullptr,
+                 false, [this] { exportLatency(); });
+    menu.showMenuAsync(
+        juce::PopupMenu::Options().withTargetComponent(btnExport));
+  }
+
+  void exportHistory() {
+    saveAs("Export Traffic Log", "traffic-log.tsv", "*.tsv;*.txt",
+           [this](juce::FileOutputStream &out) {
+             out << "time_ms\tdir\tkind\tch\tdata1\tdata2\tvalue\ttext\n";
+             for (int i = 0; i < historyCount; ++i)
+               out << exportAt(i) << "\n";
+             return juce::String(historyCount) + " records";
+           });
+  }
+
+  void exportLatency() {
+    auto json = getLatencyJson(); // snapshot now, not when the dialog closes
+    saveAs("Export Latency", "latency.json", "*.json",
+           [json](juce::FileOutputStream &out) {
+             out << json;
+             return juce::String("latency histograms");
+           });
+  }
+
+  // write fills the stream and returns a description for the log line
+  void saveAs(const juce::String &title, const juce::String &defaultName,
+              const juce::String &patterns,
+              std::function<juce::String(juce::FileOutputStream &)> write) {
+    exportChooser = std::make_unique<juce::FileChooser>(
+        title,
+        juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+            .getChildFile(defaultName),
+        patterns);
+    exportChooser->launchAsync(
+        juce::FileBrowserComponent::saveMode |
+            juce::FileBrowserComponent::warnAboutOverwriting,
+        [this, write](const juce::FileChooser &fc) {
+          auto file = fc.getResult();
+          if (file == juce::File())
+            return;
+          juce::FileOutputStream out(file);
+          if (!out.openedOk()) {
+            log("Export failed: " + file.getFileName(), true);
+            return;
+          }
+          out.setPosition(0);
+          out.truncate();
+          auto what = write(out);
+          log("Exported " + what + " to " + file.getFileName(), true);
+        });
+  }
+
+  LogRing<LogEvent> ring;
+  std::atomic<bool> paused{false};
+
+  // Message thread only
+  std::vector<LogEvent> history; // circular, historySize records
+  std::vector<juce::String> historyText; // joined status lines, same slots
+  LogTextJoiner textJoiner;
+  int historyNext = 0, historyCount = 0;
+  std::deque<int> lineLengths; // chars per displayed line
+  std::unique_ptr<juce::FileChooser> exportChooser;
 };
 
 class MidiPlaylist : public juce::Component,
@@ -150,6 +270,7 @@ public:
   PlayMode playMode = Single;
   juce::TextButton btnLoopMode{"Single"};
   std::function<void(juce::String)> onLoopModeChanged;
+  std::function<void()> onFilesChanged; // added, removed or reordered
 
   juce::TextButton btnClearPlaylist{"Clear"};
   juce::Label lblTitle{{}, "Playlist"};
@@ -208,6 +329,8 @@ public:
       files.clear();
       list.updateContent();
       list.repaint();
+      if (onFilesChanged)
+        onFilesChanged();
     };
   }
 
@@ -216,6 +339,25 @@ public:
       files.add(path);
       list.updateContent();
       list.repaint();
+      if (onFilesChanged)
+        onFilesChanged();
+    }
+  }
+
+  // The file getNextFile() would return, without moving the selection
+  juce::String peekNextFile() const {
+    if (files.isEmpty())
+      return "";
+    return files[(currentIndex + 1) % files.size()];
+  }
+
+  // Follows playback when it moves on by itself (gapless Loop All)
+  void setCurrentFile(const juce::String &path) {
+    int index = files.indexOf(path);
+    if (index >= 0 && index != currentIndex) {
+      currentIndex = index;
+      list.selectRow(currentIndex);
+      list.repaint();
     }
   }
 
@@ -304,6 +446,8 @@ public:
       list.updateContent();
       list.selectRow(currentIndex); // Keep selection
       list.repaint();
+      if (onFilesChanged)
+        onFilesChanged();
     }
   }
 
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+    Source/Core/ActiveNotes.h
+    Sounding-note bitset for one output (16 channels x 128 notes)
+  ==============================================================================
+*/
+#pragma once
+#include <array>
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <utility>
+
+// Which notes the bridge has left sounding on one destination, 256 bytes.
+// Every send path marks its note-ons and clears its note-offs from whatever
+// thread it runs on (one atomic or/and per note), so panic, stop and mutes
+// can release exactly the held notes instead of all 2048.
+class ActiveNotes {
+public:
+  void noteOn(int ch, int note) {
+    if (auto *w = word(ch, note))
+      w->fetch_or(bit(note), std::memory_order_relaxed);
+  }
+
+  void noteOff(int ch, int note) {
+    if (auto *w = word(ch, note))
+      w->fetch_and(~bit(note), std::memory_order_relaxed);
+  }
+
+  // Note on/off (velocity 0 = off) and All Notes/Sound Off; others ignored
+  void track(const juce::MidiMessage &m) {
+    if (m.isNoteOn())
+      noteOn(m.getChannel(), m.getNoteNumber());
+    else if (m.isNoteOff())
+      noteOff(m.getChannel(), m.getNoteNumber());
+    else if (m.isAllNotesOff() || m.isAllSoundOff())
+      release(m.getChannel(), [](int) {});
+  }
+
+  bool isOn(int ch, int note) const {
+    auto *w = word(ch, note);
+    return w != nullptr && (w->load(std::memory_order_relaxed) & bit(note));
+  }
+
+  // Clears the channel and calls fn(note) for each note that was on. Each
+  // held note goes to exactly one caller, even with releases racing.
+  template <typename Fn> void release(int ch, Fn &&fn) {
+    release(ch, 0, 127, std::forward<Fn>(fn));
+  }
+
+  // The same for the notes lowest..highest only
+  template <typename Fn>
+  void release(int ch, int lowest, int highest, Fn &&fn) {
+    if (ch < 1 || ch > 16)
+      return;
+    for (int half = 0; half < 2; ++half) {
+      const int lo = juce::jmax(lowest - half * 64, 0);
+      const int hi = juce::jmin(highest - half * 64, 63);
+      if (lo > hi)
+        continue;
+      const auto all = ~juce::uint64(0);
+      const auto mask = (all >> (63 - hi)) & (all << lo);
+      auto bits = words[(size_t)((ch - 1) * 2 + half)].fetch_and(
+                      ~mask, std::memory_order_relaxed) &
+                  mask;
+      for (int i = 0; bits != 0; ++i, bits >>= 1)
+        if (bits & 1)
+          fn(half * 64 + i);
+    }
+  }
+
+  int count() const {
+    int n = 0;
+    for (auto &w : words)
+      n += juce::countNumberOfBits(w.load(std::memory_order_relaxed));
+    return n;
+  }
+
+private:
+  static juce::uint64 bit(int note) { return juce::uint64(1) << (note & 63); }
+
+  std::atomic<juce::uint64> *word(int ch, int note) {
+    if (ch < 1 || ch > 16 || note < 0 || note > 127)
+      return nullptr;
+    return &words[(size_t)((ch - 1) * 2 + note / 64)];
+  }
+  const std::atomic<juce::uint64> *word(int ch, int note) const {
+    return const_cast<ActiveNotes *>(this)->word(ch, note);
+  }
+
+  std::array<std::atomic<juce::uint64>, 32> words{};
+};
@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+    Source/Core/Arpeggiator.h
+    Latched note set and step patterns for the scheduler-driven arpeggiator
+  ==============================================================================
+*/
+#pragma once
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <juce_core/juce_core.h>
+
+// The notes the arp cycles through, in arrival order and in pitch order,
+// in fixed arrays: adding, removing and stepping never allocate. Notes
+// arrive from the message and MIDI threads; the scheduler thread steps.
+// Both sides take a SpinLock for a few dozen instructions at most.
+class Arpeggiator {
+public:
+  enum Pattern { Up, Down, UpDown, DownUp, PlayOrder, Random, Diverge };
+  static constexpr int maxNotes = 32; // later notes are ignored when full
+
+  // Any thread. A note already held is not added twice.
+  void noteOn(int channel, int note) {
+    if (note < 0 || note > 127)
+      return;
+    const juce::SpinLock::ScopedLockType sl(lock);
+    if (count == maxNotes || indexOf(sorted, note) >= 0)
+      return;
+    arrival[(size_t)count] = (juce::uint8)note;
+    int i = count++;
+    for (; i > 0 && sorted[(size_t)i - 1] > note; --i)
+      sorted[(size_t)i] = sorted[(size_t)i - 1];
+    sorted[(size_t)i] = (juce::uint8)note;
+    outputChannel = juce::jlimit(1, 16, channel);
+  }
+
+  void noteOff(int note) {
+    const juce::SpinLock::ScopedLockType sl(lock);
+    remove(sorted, note);
+    if (remove(arrival, note))
+      --count;
+  }
+
+  void clear() {
+    const juce::SpinLock::ScopedLockType sl(lock);
+    count = 0;
+  }
+
+  bool isEmpty() const { return count == 0; }
+  int getChannel() const { return outputChannel; } // of the latest note
+
+  // Scheduler thread: the note for the next step, or -1 with nothing held
+  int step(Pattern pattern) {
+    const juce::SpinLock::ScopedLockType sl(lock);
+    const int n = count;
+    if (n == 0) {
+      stepIndex = 0;
+      return -1;
+    }
+    const int k = stepIndex++ % patternLength(pattern, n);
+    switch (pattern) {
+    case Up:
+      return sorted[(size_t)k];
+    case Down:
+      return sorted[(size_t)(n - 1 - k)];
+    case UpDown:
+      return sorted[(size_t)(k < n ? k : 2 * n - 2 - k)];
+    case DownUp:
+      return sorted[(size_t)(n - 1 - (k < n ? k : 2 * n - 2 - k))];
+    case PlayOrder:
+      return arrival[(size_t)k];
+    case Random:
+      return sorted[(size_t)random.nextInt(n)];
+    case Diverge: { // middle note first, then outwards, alternating sides
+      const int centre = (n - 1) / 2, offset = (k + 1) / 2;
+      return sorted[(size_t)(k % 2 == 1 ? centre + offset : centre - offset)];
+    }
+    }
+    return -1;
+  }
+
+  // Sync mode: the musical step length (in beats) closest to `beats`
+  static double nearestDivision(double beats) {
+    static constexpr double divisions[] = {1.0 / 8, 1.0 / 6, 1.0 / 4, 1.0 / 3,
+                                           1.0 / 2, 1.0,     2.0};
+    double best = divisions[0];
+    for (auto d : divisions)
+      if (std::abs(std::log(d / beats)) < std::abs(std::log(best / beats)))
+        best = d;
+    return best;
+  }
+
+private:
+  using Notes = std::array<juce::uint8, maxNotes>;
+
+  // Up/Down and Down/Up turn around without repeating the end notes
+  static int patternLength(Pattern p, int n) {
+    return (p == UpDown || p == DownUp) && n > 1 ? 2 * n - 2 : n;
+  }
+
+  int indexOf(const Notes &notes, int note) const {
+    for (int i = 0; i < count; ++i)
+      if (notes[(size_t)i] == note)
+        return i;
+    return -1;
+  }
+
+  bool remove(Notes &notes, int note) {
+    int i = indexOf(notes, note);
+    if (i < 0)
+      return false;
+    for (; i + 1 < count; ++i)
+      notes[(size_t)i] = notes[(size_t)i + 1];
+    return true;
+  }
+
+  juce::SpinLock lock;
+  Notes arrival{}, sorted{};
+  std::atomic<int> count{0};
+  std::atomic<int> outputChannel{1};
+  int stepIndex = 0;   // scheduler thread, under lock
+  juce::Random random; // same
+};
@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+    Source/Core/BridgeClock.h
+    Time source for the transport and scheduler: Link's clock or a virtual one
+  ==============================================================================
+*/
+#pragma once
+#include <ableton/Link.hpp>
+#include <atomic>
+#include <chrono>
+#include <juce_core/juce_core.h>
+
+// What the transport, the scheduler tick and playback read as "now". Two
+// scales, as the engine uses both: micros() for Link beat/time conversion
+// and millis() for NoteScheduler deadlines.
+class BridgeClock {
+public:
+  virtual ~BridgeClock() = default;
+  virtual std::chrono::microseconds micros() const = 0; // Link clock scale
+  virtual double millis() const = 0; // getMillisecondCounterHiRes() scale
+};
+
+// Wall time, for a live engine
+class LinkClock : public BridgeClock {
+public:
+  explicit LinkClock(const ableton::Link &l) : link(l) {}
+  std::chrono::microseconds micros() const override {
+    return link.clock().micros();
+  }
+  double millis() const override {
+    return juce::Time::getMillisecondCounterHiRes();
+  }
+
+private:
+  const ableton::Link &link;
+};
+
+// Stands still until advanced, so the scheduler can be ticked back to back
+// and a run gives the same times every time. Starts at a real Link time so
+// session state captured before the switch stays consistent; reset() moves
+// the start onto a point of the Link timeline (see OfflineRender).
+class VirtualClock : public BridgeClock {
+public:
+  explicit VirtualClock(std::chrono::microseconds start)
+      : startMicros(start.count()), nowMicros(start.count()) {}
+
+  void reset(std::chrono::microseconds start) {
+    startMicros = start.count();
+    nowMicros = start.count();
+  }
+
+  void advance(std::chrono::microseconds step) { nowMicros += step.count(); }
+  double getElapsedMs() const { return (nowMicros - startMicros) / 1000.0; }
+
+  std::chrono::microseconds micros() const override {
+    return std::chrono::microseconds(nowMicros.load());
+  }
+  double millis() const override { return nowMicros / 1000.0; }
+
+private:
+  std::atomic<juce::int64> startMicros, nowMicros;
+};
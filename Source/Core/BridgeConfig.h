@@ -0,0 +1,264 @@
+/*
+  ==============================================================================
+    Source/Core/BridgeConfig.h
+    Bridge settings for headless runs: command-line flags and config files
+  ==============================================================================
+*/
+#pragma once
+#include "OscRouting.h"
+#include <array>
+#include <iterator>
+#include <juce_core/juce_core.h>
+
+// Everything a headless bridge needs to come up without a window. Filled
+// from a JSON config file (--config) and then from command-line flags, so a
+// flag overrides the file. JSON keys are the flag names without "--".
+struct BridgeConfig {
+  juce::String ip = "127.0.0.1";
+  int sendPort = 3330, receivePort = 5550;
+  bool connectOsc = true;
+  juce::String midiIn, midiOut; // device name, or part of one; empty = none
+  int midiChannel = 17;         // 17 = All
+  double bpm = 0.0;             // 0 = keep Link's / the file's tempo
+  bool link = true;
+  bool bundle = false;
+  int maxBundleBytes = 1400;
+  int probeMs = 0; // 0 = no round-trip probe
+  bool answerPings = false;
+  bool split = false, retrigger = false;
+  int octave = 0; // file playback octave shift
+  // Mixer strip order: output channel per source channel, and the unmuted
+  // output channels (bit 0 = channel 1)
+  std::array<int, 16> channelMap{1, 2,  3,  4,  5,  6,  7,  8,
+                                 9, 10, 11, 12, 13, 14, 15, 16};
+  juce::uint32 activeChannels = 0xffff;
+  juce::File midiFile; // played on start
+  bool loop = false;
+  juce::File renderFile; // render midiFile offline to here, then exit
+  bool renderCheck = false; // render twice, fail unless byte-identical
+  juce::File captureFile;
+  int statsSeconds = 0; // 0 = no periodic stats line
+  bool verbose = false; // print every routed message, not just status
+  OscAddresses addresses;
+
+  // Returns an error message, empty on success
+  juce::String parse(const juce::StringArray &args) {
+    auto configIndex = args.indexOf("--config");
+    if (configIndex >= 0) {
+      if (configIndex + 1 >= args.size())
+        return "--config needs a file";
+      auto file = juce::File::getCurrentWorkingDirectory().getChildFile(
+          args[configIndex + 1].unquoted());
+      if (!file.existsAsFile())
+        return "cannot read " + file.getFullPathName();
+      auto json = juce::JSON::parse(file);
+      auto *object = json.getDynamicObject();
+      if (object == nullptr)
+        return file.getFullPathName() + " is not a JSON object";
+      for (auto &property : object->getProperties()) {
+        auto error = set(property.name.toString(), property.value);
+        if (error.isNotEmpty())
+          return file.getFileName() + ": " + error;
+      }
+    }
+
+    for (int i = 0; i < args.size(); ++i) {
+      auto arg = args[i];
+      if (!arg.startsWith("--"))
+        return "unexpected argument " + arg;
+      auto key = arg.substring(2);
+      if (key == "headless" || key == "help")
+        continue;
+      if (key == "config") {
+        ++i;
+        continue;
+      }
+      juce::String error;
+      if (key == "no-link")
+        error = set("link", false);
+      else if (key == "no-connect")
+        error = set("connect", false);
+      else if (isSwitch(key))
+        error = set(key, true);
+      else if (i + 1 >= args.size())
+        error = "needs a value";
+      else
+        error = set(key, args[++i].unquoted());
+      if (error.isNotEmpty())
+        return arg + ": " + error;
+    }
+    return {};
+  }
+
+  static juce::String getUsage() {
+    return "Usage: PatchworldBridge --headless [options]\n"
+           "  --config <file.json>    settings file; keys are the option\n"
+           "                          names below, flags override it\n"
+           "  --ip <address>          OSC target (127.0.0.1)\n"
+           "  --out-port <n>          OSC send port (3330)\n"
+           "  --in-port <n>           OSC receive port (5550)\n"
+           "  --no-connect            don't open the OSC ports\n"
+           "  --midi-in <name>        MIDI input device (name or part)\n"
+           "  --midi-out <name>       MIDI output device (name or part)\n"
+           "  --channel <1-16|all>    channel for MIDI -> OSC (all)\n"
+           "  --bpm <tempo>           initial tempo\n"
+           "  --no-link               start with Ableton Link off\n"
+           "  --bundle                bundle OSC output per 1 ms tick\n"
+           "  --max-bundle <bytes>    largest bundle datagram (1400)\n"
+           "  --probe <ms>            OSC round-trip probe interval\n"
+           "  --answer-pings          reply to another bridge's probe\n"
+           "  --split                 split channel 1 at middle C\n"
+           "  --retrigger             key release re-triggers the note\n"
+           "  --octave <-4..4>        MIDI file octave shift\n"
+           "  --map <ch,ch,...>       output channel for source 1, 2, ...\n"
+           "  --mute <ch,ch,...>      output channels to mute\n"
+           "  --file <file.mid>       play a MIDI file on start\n"
+           "  --loop                  loop the MIDI file\n"
+           "  --render <events.txt>   play --file offline, as fast as\n"
+           "                          possible, write what it sends and exit\n"
+           "  --render-check          render twice, fail unless identical\n"
+           "  --capture <file.pwcap>  capture all traffic to a file\n"
+           "  --stats <seconds>       print stats periodically\n"
+           "  --verbose               print every routed message\n"
+           "  --rx-play, --rx-stop, --rx-tap, --rx-panic, --rx-vol1,\n"
+           "  --rx-vol2, --rx-note, --rx-note-off, --rx-wheel,\n"
+           "  --tx-note, --tx-velocity, --tx-note-off, --tx-cc,\n"
+           "  --tx-cc-value, --tx-pitch, --tx-pressure, --tx-poly <address>\n"
+           "                          OSC addresses, {X} = channel\n";
+  }
+
+private:
+  static bool isSwitch(const juce::String &key) {
+    return key == "bundle" || key == "answer-pings" || key == "split" ||
+           key == "retrigger" || key == "loop" || key == "render-check" ||
+           key == "verbose";
+  }
+
+  static bool toBool(const juce::var &v) {
+    return v.isBool() ? (bool)v
+                      : v.toString().trim().equalsIgnoreCase("true") ||
+                            v.toString().trim() == "1";
+  }
+
+  // "1,3,2" -> {1, 3, 2}; empty if any entry is not a channel 1-16
+  static juce::Array<int> toChannelList(const juce::String &text) {
+    juce::Array<int> channels;
+    for (auto &item : juce::StringArray::fromTokens(text, ",", "")) {
+      int ch = item.trim().getIntValue();
+      if (ch < 1 || ch > 16)
+        return {};
+      channels.add(ch);
+    }
+    return channels;
+  }
+
+  static juce::File toFile(const juce::var &v) {
+    return juce::File::getCurrentWorkingDirectory().getChildFile(
+        v.toString());
+  }
+
+  juce::String set(const juce::String &key, const juce::var &value) {
+    auto text = value.toString().trim();
+    auto port = [&text](int &target) -> juce::String {
+      target = text.getIntValue();
+      return juce::isPositiveAndBelow(target, 65536) && target > 0
+                 ? juce::String()
+                 : "not a port number";
+    };
+
+    static const char *const txKeys[] = {
+        "tx-note",     "tx-velocity", "tx-note-off", "tx-cc",
+        "tx-cc-value", "tx-pitch",    "tx-pressure", "tx-poly"};
+    for (int t = 0; t < (int)std::size(txKeys); ++t)
+      if (key == txKeys[t]) {
+        addresses.tx.set(t, text);
+        return {};
+      }
+
+    if (key == "ip")
+      ip = text;
+    else if (key == "out-port")
+      return port(sendPort);
+    else if (key == "in-port")
+      return port(receivePort);
+    else if (key == "connect")
+      connectOsc = toBool(value);
+    else if (key == "midi-in")
+      midiIn = text;
+    else if (key == "midi-out")
+      midiOut = text;
+    else if (key == "channel") {
+      midiChannel = text.equalsIgnoreCase("all") ? 17 : text.getIntValue();
+      if (midiChannel < 1 || midiChannel > 17)
+        return "expected 1-16 or all";
+    } else if (key == "bpm") {
+      bpm = text.getDoubleValue();
+      if (bpm < 20.0 || bpm > 444.0)
+        return "expected 20-444";
+    } else if (key == "link")
+      link = toBool(value);
+    else if (key == "bundle")
+      bundle = toBool(value);
+    else if (key == "max-bundle")
+      maxBundleBytes = text.getIntValue();
+    else if (key == "probe")
+      probeMs = text.getIntValue();
+    else if (key == "answer-pings")
+      answerPings = toBool(value);
+    else if (key == "split")
+      split = toBool(value);
+    else if (key == "retrigger")
+      retrigger = toBool(value);
+    else if (key == "octave") {
+      octave = text.getIntValue();
+      if (octave < -4 || octave > 4)
+        return "expected -4 to 4";
+    } else if (key == "map") {
+      auto channels = toChannelList(text);
+      if (channels.isEmpty() || channels.size() > 16)
+        return "expected up to 16 channels, 1-16";
+      for (int i = 0; i < channels.size(); ++i)
+        channelMap[(size_t)i] = channels[i];
+    } else if (key == "mute") {
+      auto channels = toChannelList(text);
+      if (channels.isEmpty())
+        return "expected channels 1-16";
+      for (auto ch : channels)
+        activeChannels &= ~(1u << (ch - 1));
+    } else if (key == "file")
+      midiFile = toFile(value);
+    else if (key == "loop")
+      loop = toBool(value);
+    else if (key == "render")
+      renderFile = toFile(value);
+    else if (key == "render-check")
+      renderCheck = toBool(value);
+    else if (key == "capture")
+      captureFile = toFile(value);
+    else if (key == "stats")
+      statsSeconds = text.getIntValue();
+    else if (key == "verbose")
+      verbose = toBool(value);
+    else if (key == "rx-play")
+      addresses.play = text;
+    else if (key == "rx-stop")
+      addresses.stop = text;
+    else if (key == "rx-tap")
+      addresses.tap = text;
+    else if (key == "rx-panic")
+      addresses.panic = text;
+    else if (key == "rx-vol1")
+      addresses.vol1 = text;
+    else if (key == "rx-vol2")
+      addresses.vol2 = text;
+    else if (key == "rx-note")
+      addresses.noteOn = text;
+    else if (key == "rx-note-off")
+      addresses.noteOff = text;
+    else if (key == "rx-wheel")
+      addresses.pitchWheel = text;
+    else
+      return "unknown option " + key;
+    return {};
+  }
+};
@@ -0,0 +1,1196 @@
+/*
+  ==============================================================================
+    Source/Core/BridgeEngine.cpp
+  ==============================================================================
+*/
+
+#include "BridgeEngine.h"
+#include <cmath>
+#include <utility>
+
+BridgeEngine::BridgeEngine() {
+  for (int i = 0; i < 16; ++i)
+    channelNames.add(juce::String(i + 1));
+  audioMidi.ensureSize(4096);
+  oscOut.setCapture(&capture);
+  probe.sendPing = [this](const juce::OSCMessage &m) { oscOut.sendNow(m); };
+
+  replayer.onRecord = [this](const CaptureRecord &r) {
+    if (r.isOsc()) {
+      if (replayOscLoopback)
+        replaySender.send(r.toOscMessage());
+    } else {
+      routeMidiInput(r.toMidiMessage(), replayToKeyboardQueue);
+    }
+  };
+  replayer.onFinished = [this] { log("Replay: finished"); };
+
+  // Parsed on the loader thread; playback picks it up at a safe point
+  prefetchLoader.onLoaded = [this](std::shared_ptr<const LoadedMidiFile> file,
+                                   const juce::File &source) {
+    // A parse that finishes after prefetch() moved on must not replace
+    // the newer entry's slot
+    const juce::SpinLock::ScopedLockType sl(prefetchLock);
+    if (source == juce::File(prefetchPath))
+      std::atomic_store(&nextFile, std::move(file));
+  };
+  fileLoader.onLoaded = [this](std::shared_ptr<const LoadedMidiFile> file,
+                               const juce::File &source) {
+    if (file == nullptr) {
+      log("! Could not read " + source.getFileName());
+      // Loop All asked for this file at the end of the last one; let it
+      // ask again (for the entry after) instead of waiting forever
+      juce::ScopedLock sl(midiLock);
+      skipRequested = false;
+      return;
+    }
+    std::atomic_store(&pendingFile, std::move(file));
+  };
+
+  setOscAddresses({});
+}
+
+BridgeEngine::~BridgeEngine() { shutdown(); }
+
+void BridgeEngine::start() {
+  // As last set by setLinkEnabled, so a config with Link off never joins
+  link.enable(linkWanted);
+  link.enableStartStopSync(linkWanted);
+  juce::HighResolutionTimer::startTimer(1);
+}
+
+void BridgeEngine::shutdown() {
+  juce::HighResolutionTimer::stopTimer();
+  replayer.stop();
+  probe.stop();
+  // Stop receiver-thread callbacks before any member they touch goes away
+  oscReceiver.removeListener(this);
+  oscReceiver.disconnect();
+  oscConnected = false;
+  if (midiInput != nullptr) {
+    midiInput->stop();
+    midiInput.reset();
+  }
+  capture.stop();
+  link.enable(false);
+}
+
+//==============================================================================
+// CONFIGURATION
+//==============================================================================
+void BridgeEngine::applyConfig(const BridgeConfig &config) {
+  setOscAddresses(config.addresses);
+  setOscBundling(config.bundle, config.maxBundleBytes);
+  setProbeSettings(config.probeMs, config.answerPings);
+  setSplitEnabled(config.split);
+  setRetriggerEnabled(config.retrigger);
+  setPlaybackOctaveShift(config.octave);
+  setChannelMap(config.channelMap, config.activeChannels);
+  setMidiChannel(config.midiChannel);
+  setPlaylistMode(config.loop ? LoopOne : Single);
+  setLinkEnabled(config.link);
+  if (config.bpm > 0.0)
+    setTempo(config.bpm);
+}
+
+void BridgeEngine::setOscAddresses(const OscAddresses &newAddresses) {
+  std::atomic_store(&oscAddresses, std::shared_ptr<const OscAddresses>(
+                                       std::make_shared<OscAddresses>(
+                                           newAddresses)));
+  rebuildOscDispatch();
+  rebuildOscTxCache();
+}
+
+void BridgeEngine::setChannelNames(const juce::StringArray &names) {
+  channelNames = names;
+  rebuildOscTxCache();
+}
+
+void BridgeEngine::setChannelMap(const std::array<int, 16> &mapping,
+                                 juce::uint32 activeMask) {
+  // Notes already sounding on a channel being muted would never get their
+  // note-offs, which playback drops along with everything else
+  const auto muted = channelMap.getActiveMask() & ~activeMask;
+  if (muted == 0) {
+    channelMap.set(mapping, activeMask);
+    return;
+  }
+
+  // Where the notes are held depends on the map they were sent under.
+  // Playback mutes output channel o and sends its OSC to map(o), but its
+  // MIDI goes out on the file's own channel s: every s mapped to o, and
+  // with split on, the lower or upper half of the source mapped to 1.
+  auto isMuted = [muted](int out) {
+    return out >= 1 && out <= 16 && ((muted >> (out - 1)) & 1u) != 0;
+  };
+  const bool split = splitEnabled;
+  juce::uint32 oscChannels = 0;
+  std::array<std::pair<int, int>, 16> midiRanges; // notes per source channel
+  for (int ch = 1; ch <= 16; ++ch) {
+    const int out = channelMap.map(ch);
+    if (isMuted(ch)) {
+      const int oscCh = juce::isPositiveAndBelow(out - 1, 16) ? out : 1;
+      oscChannels |= 1u << (oscCh - 1);
+    }
+    auto &range = midiRanges[(size_t)ch - 1];
+    range = {128, -1};
+    if (split && out == 1)
+      range = {isMuted(2) ? 0 : 64, isMuted(1) ? 127 : 63};
+    else if (isMuted(out))
+      range = {0, 127};
+  }
+
+  channelMap.set(mapping, activeMask);
+  releaseOscNotes(oscChannels);
+  for (int ch = 1; ch <= 16; ++ch)
+    releaseMidiNotes(ch, midiRanges[(size_t)ch - 1].first,
+                     midiRanges[(size_t)ch - 1].second);
+}
+
+void BridgeEngine::setOscBundling(bool shouldBundle, int maxBytes) {
+  oscOut.setMaxBundleBytes(maxBytes);
+  if (shouldBundle != oscOut.isEnabled()) {
+    oscOut.setEnabled(shouldBundle);
+    log(shouldBundle ? "OSC Bundling: ON" : "OSC Bundling: OFF");
+  }
+}
+
+void BridgeEngine::setProbeSettings(int intervalMs, bool respond) {
+  probeIntervalMs = intervalMs;
+  answerPings = respond;
+  if (oscConnected)
+    probe.start(intervalMs);
+}
+
+void BridgeEngine::rebuildOscDispatch() {
+  // The OSC receiver thread may be mid-lookup on the old table
+  std::atomic_store(&oscDispatch, OscDispatchTable::build(
+                                      *std::atomic_load(&oscAddresses)));
+}
+
+void BridgeEngine::rebuildOscTxCache() {
+  auto addr = std::atomic_load(&oscAddresses);
+  std::atomic_store(&oscTxCache, std::shared_ptr<const OscAddressCache>(
+                                     std::make_shared<OscAddressCache>(
+                                         addr->tx, channelNames)));
+}
+
+//==============================================================================
+// OSC
+//==============================================================================
+bool BridgeEngine::connectOsc(const juce::String &ip, int sendPort,
+                              int receivePort) {
+  if (!oscSender.connect(ip, sendPort)) {
+    log("! OSC: cannot send to " + ip + ":" + juce::String(sendPort));
+    return false;
+  }
+  // Half a bridge that sends but never hears the headset is a failure too
+  if (!oscReceiver.connect(receivePort)) {
+    log("! OSC: cannot listen on port " + juce::String(receivePort));
+    oscSender.disconnect();
+    return false;
+  }
+  oscReceiver.addListener(this);
+  oscOut.setDirectTarget(ip, sendPort);
+  oscReceivePort = receivePort;
+  oscConnected = true;
+  log("OSC Connected");
+  oscOut.resetCounters();
+  latency.reset();
+  probe.start(probeIntervalMs);
+  return true;
+}
+
+void BridgeEngine::disconnectOsc() {
+  probe.stop();
+  oscOut.flush();
+  oscOut.setDirectTarget({}, 0);
+  oscSender.disconnect();
+  oscReceiver.disconnect();
+  oscConnected = false;
+  log("OSC Disconnected");
+}
+
+void BridgeEngine::setOscSink(
+    std::function<void(const juce::OSCMessage &)> sink) {
+  oscOut.setSink(std::move(sink));
+  oscConnected = oscOut.hasSink();
+}
+
+void BridgeEngine::sendOsc(const juce::String &address, float value) {
+  if (oscConnected)
+    oscOut.send(address, value);
+}
+
+// Runs on the OSC receiver thread (RealtimeCallback): MIDI-bound messages
+// never wait behind painting; anything for the message thread is posted.
+void BridgeEngine::oscMessageReceived(const juce::OSCMessage &m) {
+  const auto receivedMicros = LatencyHistogram::nowMicros();
+  capture.recordOsc(m, CaptureRecord::OscIn);
+  juce::String addr = m.getAddressPattern().toString();
+  float val = (m.size() > 0 && m[0].isFloat32()) ? m[0].getFloat32() : 0.0f;
+  float vel = (m.size() > 1 && m[1].isFloat32()) ? m[1].getFloat32() : 0.0f;
+
+  if (trafficLogging && onLog) {
+    auto e = LogEvent::make(LogEvent::Osc, LogEvent::In);
+    e.setText(addr.toRawUTF8());
+    e.value = val;
+    onLog(e);
+  }
+
+  // --- STANDARD MIDI LOGIC ---
+  float scaledVal = (val <= 1.0f && val > 0.0f) ? val * 127.0f : val;
+  int scaledInt = (int)scaledVal;
+
+  auto dispatch = std::atomic_load(&oscDispatch);
+  if (dispatch == nullptr)
+    return;
+  auto route = dispatch->find(addr);
+  int ch = route.channel;
+  switch (route.action) {
+  // Handle Playback Controls
+  case OscRoute::Action::Play:
+    postToMessageThread([this] { togglePlay(); });
+    return;
+  case OscRoute::Action::Stop:
+    postToMessageThread([this] { stop(); });
+    return;
+  case OscRoute::Action::Tap:
+    postToMessageThread([this] { tapTempo(); });
+    return;
+  case OscRoute::Action::Panic:
+    postToMessageThread([this] { panic(); });
+    return;
+
+  // Handle Simple Mode Faders (Vol1 / Vol2)
+  case OscRoute::Action::Vol1:
+  case OscRoute::Action::Vol2: {
+    int fader = route.action == OscRoute::Action::Vol1 ? 1 : 2;
+    postToMessageThread([this, fader, val] {
+      if (onVolumeReceived)
+        onVolumeReceived(fader, val);
+    });
+    return;
+  }
+
+  // Handle Configurable Note On
+  // MIDI goes straight to the scheduler thread; the keyboard display is
+  // updated later on the message thread.
+  case OscRoute::Action::NoteOn: {
+    float velocity = (m.size() > 1) ? vel : 0.8f;
+    int note = juce::jlimit(0, 127, scaledInt);
+    oscToMidiQueue.push(
+        {RawMidi::from(juce::MidiMessage::noteOn(ch, note, velocity)),
+         receivedMicros});
+    echo(oscToKeyboardQueue, ch, note, juce::jmax(0.001f, velocity));
+    return;
+  }
+
+  // Handle Configurable Note Off
+  case OscRoute::Action::NoteOff: {
+    int note = juce::jlimit(0, 127, scaledInt);
+    oscToMidiQueue.push(
+        {RawMidi::from(juce::MidiMessage::noteOff(ch, note)), receivedMicros});
+    echo(oscToKeyboardQueue, ch, note, 0.0f);
+    return;
+  }
+
+  // Handle Configurable Pitch Wheel
+  case OscRoute::Action::PitchWheel: {
+    int bend = juce::jlimit(0, 16383, (int)(val * 16383.0f));
+    oscToMidiQueue.push({RawMidi::from(juce::MidiMessage::pitchWheel(ch, bend)),
+                         receivedMicros});
+    return;
+  }
+
+  // Round-trip probe: answer the other end's pings, time our own pongs
+  case OscRoute::Action::ProbePing:
+    if (answerPings && m.size() > 0 && m[0].isInt32())
+      oscOut.sendNow(
+          juce::OSCMessage(juce::OSCAddressPattern(OscEchoProbe::pongAddress),
+                           m[0].getInt32()));
+    return;
+  case OscRoute::Action::ProbePong:
+    if (m.size() > 0 && m[0].isInt32())
+      probe.handlePong(m[0].getInt32());
+    return;
+
+  case OscRoute::Action::None:
+    return;
+  }
+}
+
+void BridgeEngine::sendSplitOscMessage(const juce::MidiMessage &m,
+                                       int overrideChannel, bool direct) {
+  if (!oscConnected)
+    return;
+
+  // Readers may be on the playback thread while the UI swaps in a new cache
+  auto tx = std::atomic_load(&oscTxCache);
+  if (tx == nullptr)
+    return;
+
+  // MIDI input encodes into this instead of building OSCMessages
+  OscPacket packet;
+  direct = direct && oscOut.canSendDirect();
+
+  auto sendTo = [this, &m, &tx, &packet, direct](int rawCh) {
+    int ch = channelMap.map(rawCh);
+    if (ch < 1 || ch > 16)
+      ch = 1;
+    auto send = [this, &tx, &packet, direct, ch](OscAddressCache::Type type,
+                                                auto... args) {
+      if (auto *addr = tx->get(ch, type))
+        if (!direct || !packet.add(*addr, {args...}))
+          oscOut.send(*addr, args...);
+    };
+
+    if (m.isNoteOn()) {
+      send(OscAddressCache::NoteOn, (float)m.getNoteNumber());
+      send(OscAddressCache::NoteVelocity, m.getVelocity() / 127.0f);
+      oscNotes.noteOn(ch, m.getNoteNumber());
+    } else if (m.isNoteOff()) {
+      send(OscAddressCache::NoteOff, (float)m.getNoteNumber());
+      oscNotes.noteOff(ch, m.getNoteNumber());
+    } else if (m.isController()) {
+      send(OscAddressCache::CC, (float)m.getControllerNumber());
+      send(OscAddressCache::CCValue, (float)m.getControllerValue() / 127.0f);
+    } else if (m.isPitchWheel()) {
+      send(OscAddressCache::PitchBend,
+           (float)m.getPitchWheelValue() / 16383.0f);
+    } else if (m.isAftertouch()) {
+      send(OscAddressCache::PolyAftertouch, (float)m.getNoteNumber(),
+           m.getAfterTouchValue() / 127.0f);
+    }
+  };
+
+  int baseCh = (overrideChannel != -1)
+                   ? overrideChannel
+                   : (midiChannelSelection == 17
+                          ? (m.getChannel() > 0 ? m.getChannel() : 1)
+                          : midiChannelSelection.load());
+
+  if (splitEnabled && baseCh == 1) {
+    if (m.isNoteOnOrOff()) {
+      int n = m.getNoteNumber();
+      sendTo(n < 64 ? 2 : 1);
+    } else {
+      sendTo(1);
+      sendTo(2);
+    }
+  } else {
+    sendTo(baseCh);
+  }
+  oscOut.sendDirect(packet);
+}
+
+//==============================================================================
+// MIDI
+//==============================================================================
+bool BridgeEngine::openMidiInput(const juce::String &identifier) {
+  midiInput.reset();
+  if (identifier.isEmpty())
+    return true;
+  midiInput = juce::MidiInput::openDevice(identifier, this);
+  if (midiInput == nullptr)
+    return false;
+  midiInput->start();
+  return true;
+}
+
+bool BridgeEngine::openMidiOutput(const juce::String &identifier) {
+  std::unique_ptr<juce::MidiOutput> newOutput;
+  if (identifier.isNotEmpty())
+    newOutput = juce::MidiOutput::openDevice(identifier);
+  bool opened = identifier.isEmpty() || newOutput != nullptr;
+  if (newOutput)
+    newOutput->startBackgroundThread(); // for audio clock timed blocks
+  {
+    // Swap under the lock, close the old device outside it
+    juce::ScopedLock sl(midiOutLock);
+    std::swap(midiOutput, newOutput);
+  }
+  return opened;
+}
+
+juce::String
+BridgeEngine::findMidiDevice(const juce::Array<juce::MidiDeviceInfo> &devices,
+                             const juce::String &name) {
+  for (auto &d : devices)
+    if (d.name == name)
+      return d.identifier;
+  for (auto &d : devices)
+    if (d.name.containsIgnoreCase(name))
+      return d.identifier;
+  return {};
+}
+
+// Runs on the MIDI device thread. Notes are routed to OSC and MIDI out
+// right here; only the keyboard display is handed to the message thread.
+void BridgeEngine::handleIncomingMidiMessage(juce::MidiInput *,
+                                             const juce::MidiMessage &m) {
+  routeMidiInput(m, midiInToKeyboardQueue);
+}
+
+void BridgeEngine::receiveMidi(const juce::MidiMessage &m) {
+  routeMidiInput(m, midiInToKeyboardQueue);
+}
+
+// Hardware MIDI input, or a replayed capture. echoQueue must be the one
+// whose single producer is the calling thread.
+void BridgeEngine::routeMidiInput(const juce::MidiMessage &m,
+                                  SpscQueue<KeyboardEcho, 1024> &echoQueue) {
+  const auto receivedMicros = LatencyHistogram::nowMicros();
+  capture.recordMidi(m, CaptureRecord::MidiIn);
+  if (!m.isNoteOnOrOff()) {
+    sendSplitOscMessage(m, -1, true);
+  } else if (arpLatched) {
+    // Latched: note-ons join the arp, releases are ignored
+    if (m.isNoteOn())
+      arp.noteOn(m.getChannel(),
+                 juce::jlimit(0, 127,
+                              m.getNoteNumber() + virtualOctaveShift * 12));
+    return;
+  } else {
+    int ch = m.getChannel(), note = m.getNoteNumber();
+    float vel = m.getFloatVelocity();
+    if (m.isNoteOn()) {
+      routeNoteOn(ch, note, vel, true);
+      echo(echoQueue, ch, note, vel);
+    } else {
+      routeNoteOff(ch, note, vel, true);
+      echo(echoQueue, ch, note, 0.0f);
+    }
+  }
+  if (oscConnected)
+    latency.midiToOsc.record(LatencyHistogram::nowMicros() - receivedMicros);
+}
+
+// Keyboard note routing (octave shift, split, OSC + MIDI out). Called on the
+// message thread for the on-screen/virtual keyboard and directly on the MIDI
+// device thread for hardware input, so it only reads atomics.
+void BridgeEngine::routeNoteOn(int ch, int note, float vel, bool direct) {
+  int adj = juce::jlimit(0, 127, note + (virtualOctaveShift * 12));
+  if (splitEnabled && ch == 1 && adj < 64)
+    ch = 2;
+
+  logEvent(LogEvent::make(LogEvent::NoteOn, LogEvent::In, ch, note,
+                          juce::roundToInt(vel * 127.0f)));
+
+  sendSplitOscMessage(juce::MidiMessage::noteOn(ch, adj, vel), -1, direct);
+  sendMidiNow(juce::MidiMessage::noteOn(ch, adj, vel));
+}
+
+void BridgeEngine::routeNoteOff(int ch, int note, float vel, bool direct) {
+  int adj = juce::jlimit(0, 127, note + (virtualOctaveShift * 12));
+  // Same split as the note-on, or the upper channel never gets its release
+  if (splitEnabled && ch == 1 && adj < 64)
+    ch = 2;
+
+  if (retriggerEnabled) {
+    juce::MidiMessage m = juce::MidiMessage::noteOn(ch, adj, 100.0f / 127.0f);
+    sendSplitOscMessage(m, -1, direct);
+    sendMidiNow(m);
+  } else {
+    juce::MidiMessage m = juce::MidiMessage::noteOff(ch, adj, vel);
+    sendSplitOscMessage(m, -1, direct);
+    sendMidiNow(m);
+  }
+}
+
+void BridgeEngine::sendMidiNow(const juce::MidiMessage &m) {
+  juce::ScopedLock sl(midiOutLock);
+  if (onMidiOut)
+    onMidiOut(m);
+  else if (midiOutput)
+    midiOutput->sendMessageNow(m);
+  else
+    return;
+  midiNotes.track(m);
+  capture.recordMidi(m, CaptureRecord::MidiOut);
+}
+
+// Queues a block on the output's timed background thread; positions in
+// `block` are microseconds after startMs (getMillisecondCounterHiRes scale)
+void BridgeEngine::sendMidiBlock(const juce::MidiBuffer &block,
+                                 double startMs) {
+  juce::ScopedLock sl(midiOutLock);
+  if (onMidiOut) {
+    for (const auto meta : block) // no timed queue: handed over right away
+      onMidiOut(meta.getMessage());
+  } else if (midiOutput) {
+    midiOutput->sendBlockOfMessages(block, startMs, 1.0e6);
+  } else {
+    return;
+  }
+  const bool capturing = capture.isCapturing();
+  for (const auto meta : block) {
+    const auto m = meta.getMessage();
+    midiNotes.track(m);
+    if (capturing)
+      capture.recordMidi(m, CaptureRecord::MidiOut,
+                         startMs + meta.samplePosition / 1000.0);
+  }
+}
+
+//==============================================================================
+// TRANSPORT
+//==============================================================================
+void BridgeEngine::togglePlay() {
+  auto now = schedulerClock->micros();
+  auto session = link.captureAppSessionState();
+  const double q = quantum;
+  if (playing) {
+    log("Transport: Paused");
+    {
+      juce::ScopedLock sl(midiLock);
+      beatsPlayedOnPause = session.beatAtTime(now, q) - transportStartBeat;
+      playing = false;
+    }
+    releaseNotes();
+    session.setIsPlayingAndRequestBeatAtTime(false, now, 0.0, q);
+    link.commitAppSessionState(session);
+    return;
+  }
+
+  const bool waitForSync = link.isEnabled();
+  double startBeat;
+  {
+    juce::ScopedLock sl(midiLock);
+    startBeat = transportStartBeat =
+        session.beatAtTime(now, q) - beatsPlayedOnPause;
+    pendingSyncStart = waitForSync;
+    playing = true;
+  }
+  if (waitForSync) {
+    log("Transport: Waiting for Sync...");
+    return;
+  }
+  log("Transport: Playing (Internal)");
+  session.setIsPlayingAndRequestBeatAtTime(true, now, startBeat, q);
+  link.commitAppSessionState(session);
+  if (oscConnected)
+    oscOut.send(std::atomic_load(&oscAddresses)->play, 1.0f);
+}
+
+void BridgeEngine::stop() {
+  {
+    juce::ScopedLock sl(midiLock); // playbackCursor is playback's
+    if (!playing && playbackCursor == 0)
+      return;
+  }
+  log("Transport: Stopped");
+  auto now = schedulerClock->micros();
+  auto session = link.captureAppSessionState();
+  session.setIsPlayingAndRequestBeatAtTime(false, now, 0.0, quantum);
+  stopPlayback();
+  link.commitAppSessionState(session);
+  if (oscConnected)
+    oscOut.send(std::atomic_load(&oscAddresses)->stop, 1.0f);
+}
+
+void BridgeEngine::stopPlayback() {
+  {
+    juce::ScopedLock sl(midiLock);
+    playing = false;
+    playbackCursor = 0;
+    beatsPlayedOnPause = 0.0;
+    positionBeats = 0.0;
+    lastProcessedBeat = -1.0;
+  }
+  // Playback has stopped emitting, so nothing is re-held after this
+  releaseNotes();
+}
+
+double BridgeEngine::tapTempo() {
+  double nowMs = juce::Time::getMillisecondCounterHiRes();
+  if (!tapTimes.empty() && (nowMs - tapTimes.back() > 2000.0))
+    tapTimes.clear();
+  tapTimes.push_back(nowMs);
+  if (tapTimes.size() < 4)
+    return 0.0;
+
+  double avgDiff =
+      (tapTimes.back() - tapTimes.front()) / (double)(tapTimes.size() - 1);
+  tapTimes.clear();
+  if (avgDiff <= 50.0)
+    return 0.0;
+  double bpm = juce::jlimit(20.0, 444.0, 60000.0 / avgDiff);
+  setTempo(bpm);
+  log("Tap Tempo: " + juce::String(bpm));
+  return bpm;
+}
+
+void BridgeEngine::setTempo(double bpm) {
+  auto state = link.captureAppSessionState();
+  state.setTempo(bpm, schedulerClock->micros());
+  link.commitAppSessionState(state);
+}
+
+double BridgeEngine::getTempo() {
+  return link.captureAppSessionState().tempo();
+}
+
+void BridgeEngine::setArpLatched(bool on) {
+  arpLatched = on;
+  if (!on)
+    arp.clear(); // the last step's note-off is already scheduled
+}
+
+void BridgeEngine::setLinkEnabled(bool on) {
+  linkWanted = on;
+  link.enable(on);
+  link.enableStartStopSync(on);
+  log(on ? "Link Enabled" : "Link Disabled");
+}
+
+void BridgeEngine::panic() {
+  log("!!! PANIC !!!");
+  arp.clear();
+  noteScheduler.clear();
+  releaseNotes();
+  // For anything the device holds that didn't come from the bridge
+  for (int ch = 1; ch <= 16; ++ch) {
+    sendMidiNow(juce::MidiMessage::allNotesOff(ch));
+    sendMidiNow(juce::MidiMessage::allSoundOff(ch));
+  }
+  if (onPanic)
+    onPanic();
+}
+
+void BridgeEngine::releaseNotes(juce::uint32 channels) {
+  releaseOscNotes(channels);
+  // After the OSC burst, so the bundler's lock is not held while
+  // sendMidiNow takes the MIDI output lock
+  for (int ch = 1; ch <= 16; ++ch)
+    if ((channels >> (ch - 1)) & 1u)
+      releaseMidiNotes(ch, 0, 127);
+}
+
+void BridgeEngine::releaseOscNotes(juce::uint32 channels) {
+  if (channels == 0)
+    return;
+  auto tx = std::atomic_load(&oscTxCache);
+  const bool sendOscOffs = oscConnected && tx != nullptr;
+  oscOut.beginBurst();
+  for (int ch = 1; ch <= 16; ++ch) {
+    if (((channels >> (ch - 1)) & 1u) == 0)
+      continue;
+    auto *offAddr = sendOscOffs ? tx->get(ch, OscAddressCache::NoteOff)
+                                : nullptr;
+    oscNotes.release(ch, [this, offAddr](int note) {
+      if (offAddr != nullptr)
+        oscOut.send(*offAddr, (float)note, 0.0f);
+    });
+  }
+  oscOut.endBurst();
+}
+
+void BridgeEngine::releaseMidiNotes(int ch, int lowest, int highest) {
+  midiNotes.release(ch, lowest, highest, [this, ch](int note) {
+    sendMidiNow(juce::MidiMessage::noteOff(ch, note));
+  });
+}
+
+//==============================================================================
+// SCHEDULER / PLAYBACK
+//==============================================================================
+void BridgeEngine::hiResTimerCallback() {
+  processSchedulerTick();
+  // Everything produced this tick leaves as one datagram when bundling is on
+  oscOut.flush();
+}
+
+void BridgeEngine::processSchedulerTick() {
+  double nowMs = schedulerClock->millis();
+  auto session = link.captureAppSessionState();
+  auto now = schedulerClock->micros();
+
+  // Before popDue, so a step due now goes out this tick
+  processArp(session, now, nowMs);
+
+  // OSC -> MIDI handoff from the receiver thread
+  TimedMidi rx;
+  while (oscToMidiQueue.pop(rx)) {
+    sendMidiNow(rx.midi.toMessage());
+    latency.oscToMidi.record(LatencyHistogram::nowMicros() - rx.receivedMicros);
+  }
+
+  // Audio clock mode: what the audio callback stamped since the last tick
+  sendAudioEvents();
+
+  noteScheduler.popDue(nowMs, [this](const ScheduledEvent &e) {
+    switch (e.kind) {
+    case ScheduledEvent::NoteOn: {
+      auto m = juce::MidiMessage::noteOn(e.channel, e.note, e.velocity);
+      sendSplitOscMessage(m, e.channel);
+      sendMidiNow(m);
+      latency.schedulerLateness.record(
+          (juce::int64)((schedulerClock->millis() - e.timeMs) * 1000.0));
+      echo(schedulerToKeyboardQueue, e.channel, e.note,
+           juce::jmax(0.001f, m.getFloatVelocity()));
+      break;
+    }
+    case ScheduledEvent::NoteOff: {
+      auto m = juce::MidiMessage::noteOff(e.channel, e.note);
+      sendSplitOscMessage(m, e.channel);
+      sendMidiNow(m);
+      latency.schedulerLateness.record(
+          (juce::int64)((schedulerClock->millis() - e.timeMs) * 1000.0));
+      echo(schedulerToKeyboardQueue, e.channel, e.note, 0.0f);
+      break;
+    }
+    }
+  });
+
+  const double quantum = this->quantum;
+
+  // In audio clock mode processAudioBlock runs playback instead
+  bool sessionChanged = false;
+  if (!audioClockEnabled) {
+    juce::ScopedLock sl(midiLock);
+    sessionChanged = processPlayback(session, now, nullptr);
+  }
+  if (sessionChanged)
+    link.commitAppSessionState(session);
+
+  double currentBeat = session.beatAtTime(now, quantum);
+  positionBeats =
+      playing ? currentBeat - transportStartBeat : beatsPlayedOnPause;
+  if (onPosition)
+    onPosition(positionBeats, playingTicksPerQuarter);
+}
+
+// Queues the arp's next step once its time has come: on the Link beat grid
+// with sync on, every arpStepMs otherwise. A step is a note-on at its exact
+// time and a note-off half a step later, both through noteScheduler.
+void BridgeEngine::processArp(const ableton::Link::SessionState &session,
+                              std::chrono::microseconds now, double nowMs) {
+  if (!arpLatched || arp.isEmpty()) {
+    arpNextStepMs = -1.0;
+    arpLastStep = -1;
+    return;
+  }
+
+  const double stepMs = arpStepMs;
+  double dueMs, gateMs;
+  if (arpSync) {
+    const double q = quantum;
+    const double beatMs = 60000.0 / session.tempo();
+    const double stepBeats = Arpeggiator::nearestDivision(stepMs / beatMs);
+    const auto step = (juce::int64)std::floor(session.beatAtTime(now, q) /
+                                              stepBeats);
+    if (step == arpLastStep)
+      return;
+    const bool firstStep = arpLastStep < 0;
+    arpLastStep = step;
+    if (firstStep)
+      return; // start on the next grid line, not partway through a step
+    const auto stepTime = session.timeAtBeat((double)step * stepBeats, q);
+    dueMs = nowMs + (stepTime - now).count() / 1000.0;
+    gateMs = stepBeats * beatMs * 0.5;
+  } else {
+    if (arpNextStepMs >= 0.0 && nowMs < arpNextStepMs)
+      return;
+    // After a stall, restart from now instead of firing every missed step
+    dueMs = (arpNextStepMs < 0.0 || nowMs - arpNextStepMs > stepMs)
+                ? nowMs
+                : arpNextStepMs;
+    arpNextStepMs = dueMs + stepMs;
+    gateMs = stepMs * 0.5;
+  }
+
+  const int note = arp.step((Arpeggiator::Pattern)arpPattern.load());
+  if (note < 0)
+    return;
+  const int ch = arp.getChannel();
+  noteScheduler.schedule(dueMs, ScheduledEvent::NoteOn, ch, note, arpVelocity);
+  noteScheduler.schedule(dueMs + gateMs, ScheduledEvent::NoteOff, ch, note);
+}
+
+// Plays file events up to the beat at `now`, with midiLock held. Runs on
+// the scheduler thread (timing == nullptr, events go out immediately) or on
+// the audio thread (events are stamped at their exact time within the
+// block and queued, and everything that would lock, send or post is left
+// to the scheduler thread). Returns true when the session state was
+// changed and needs committing by the caller.
+bool BridgeEngine::processPlayback(ableton::Link::SessionState &session,
+                                   std::chrono::microseconds now,
+                                   AudioBlockTiming *timing) {
+  const double quantum = this->quantum; // once per tick
+  double currentBeat = session.beatAtTime(now, quantum);
+  bool sessionChanged = false;
+
+  // --- FILE SWAP ---
+  // A file from the loader goes live here: right away while stopped,
+  // otherwise on the next bar so the new file starts on the downbeat.
+  if (std::atomic_load(&pendingFile) != nullptr) {
+    bool running = playing && !pendingSyncStart;
+    if (running && pendingSwapBeat < 0.0)
+      pendingSwapBeat = std::ceil(currentBeat / quantum) * quantum;
+    if (!running || currentBeat >= pendingSwapBeat) {
+      auto next = std::atomic_exchange(
+          &pendingFile, std::shared_ptr<const LoadedMidiFile>());
+      playbackCursor = 0;
+      lastProcessedBeat = -1.0;
+      if (running) {
+        transportStartBeat = pendingSwapBeat;
+        // The outgoing file's note-offs will never play
+        if (timing != nullptr)
+          deferToScheduler(AudioEvent::ReleaseNotes);
+        else
+          releaseNotes();
+      } else
+        beatsPlayedOnPause = 0.0;
+      pendingSwapBeat = -1.0;
+      skipRequested = false;
+      setActiveFile(next.get());
+      // The message thread may still reference the outgoing file, so it is
+      // not freed on this thread
+      std::atomic_store(&playingFile, std::move(next));
+    }
+  }
+
+  if (playing) {
+    if (pendingSyncStart) {
+      if (session.phaseAtTime(now, quantum) < 0.05) {
+        transportStartBeat = currentBeat - beatsPlayedOnPause;
+        lastProcessedBeat = -1.0;
+        pendingSyncStart = false;
+        if (!session.isPlaying()) {
+          session.setIsPlayingAndRequestBeatAtTime(true, now, currentBeat,
+                                                   quantum);
+          sessionChanged = true;
+        }
+        if (timing != nullptr)
+          deferToScheduler(AudioEvent::SyncStarted);
+        else if (oscConnected)
+          oscOut.send(std::atomic_load(&oscAddresses)->play, 1.0f);
+      } else {
+        return sessionChanged;
+      }
+    }
+
+    double playbackBeats = currentBeat - transportStartBeat;
+    double rangeEnd = playbackBeats;
+
+    const int noteShift = pianoRollOctaveShift * 12;
+    const bool split = splitEnabled;
+    const int numEvents = activeFile ? activeFile->timeline.size() : 0;
+    while (playbackCursor < numEvents) {
+      const auto &ev = activeFile->timeline[playbackCursor];
+      if (ev.beat >= rangeEnd)
+        break;
+
+      if (ev.beat >= lastProcessedBeat) {
+        int ch = channelMap.map(ev.getChannel());
+        auto m = ev.toMessage(noteShift); // octave shift applied to notes
+
+        if (ev.isNoteOnOrOff()) {
+          int n = m.getNoteNumber();
+          if (split && ch == 1 && n < 64)
+            ch = 2;
+          logEvent(LogEvent::make(ev.isNoteOn() ? LogEvent::NoteOn
+                                                : LogEvent::NoteOff,
+                                  LogEvent::Out, ch, n, ev.data2));
+        }
+        if (channelMap.isActive(ch))
+          emitPlaybackEvent(m, ch, ev.beat, session, quantum, timing);
+      }
+      playbackCursor++;
+    }
+    lastProcessedBeat = rangeEnd;
+    if (playbackCursor >= numEvents && numEvents > 0) {
+      const int mode = playlistMode;
+      if (mode == LoopOne) {
+        playbackCursor = 0;
+        lastProcessedBeat = -1.0;
+        transportStartBeat = std::floor(currentBeat / quantum) * quantum;
+        if (transportStartBeat < currentBeat)
+          transportStartBeat += quantum;
+      } else if (mode == LoopAll) {
+        // Gapless: the prefetched next file starts on the next bar, the
+        // transport (and Link) keeps running
+        std::shared_ptr<const LoadedMidiFile> next;
+        if (!skipRequested)
+          next = std::atomic_exchange(&nextFile,
+                                      std::shared_ptr<const LoadedMidiFile>());
+        if (next != nullptr) {
+          transportStartBeat = std::ceil(currentBeat / quantum) * quantum;
+          playbackCursor = 0;
+          lastProcessedBeat = -1.0;
+          setActiveFile(next.get());
+          std::atomic_store(&playingFile, std::move(next));
+        } else if (!skipRequested) {
+          // Not prefetched (yet): load it now, it joins on a later bar
+          skipRequested = true;
+          if (timing != nullptr)
+            deferToScheduler(AudioEvent::TrackFinished);
+          else
+            postToMessageThread([this] {
+              if (onTrackFinished)
+                onTrackFinished();
+            });
+        }
+      } else {
+        playing = false;
+        session.setIsPlayingAndRequestBeatAtTime(false, now, currentBeat,
+                                                 quantum);
+        sessionChanged = true;
+      }
+    }
+  }
+  return sessionChanged;
+}
+
+void BridgeEngine::emitPlaybackEvent(
+    const juce::MidiMessage &m, int ch, double eventBeat,
+    const ableton::Link::SessionState &session, double quantum,
+    AudioBlockTiming *timing) {
+  // The quantum transportStartBeat was found with, or a file swapped in on
+  // a quantum boundary would be timed against another phase
+  auto eventTime =
+      session.timeAtBeat(transportStartBeat + eventBeat, quantum);
+  if (timing == nullptr) {
+    sendSplitOscMessage(m, ch);
+    if (!blockMidiOut)
+      sendMidiNow(m);
+    latency.schedulerLateness.record(
+        (schedulerClock->micros() - eventTime).count());
+    return;
+  }
+
+  AudioEvent e;
+  e.channel = (juce::uint8)ch;
+  e.midi = RawMidi::from(m);
+  e.timeMicros = juce::jmax(eventTime, timing->blockStart).count();
+  audioEvents.push(e);
+}
+
+// Scheduler thread: sends what processPlayback queued on the audio thread,
+// in the same order. Events are still ahead of their stamped times by
+// about the output latency, so each one is scheduled, not sent late.
+void BridgeEngine::sendAudioEvents() {
+  AudioEvent e;
+  if (!audioEvents.pop(e))
+    return;
+
+  const auto now = schedulerClock->micros();
+  const double nowMs = schedulerClock->millis();
+  const auto toUnixMicros = wallClockOffsetMicros.load();
+  audioMidi.clear();
+  do {
+    switch (e.kind) {
+    case AudioEvent::Play: {
+      const auto m = e.midi.toMessage();
+      // OSC time tag: NTP seconds since 1900 with a 32-bit fraction
+      auto unixMicros = e.timeMicros + toUnixMicros;
+      auto ntpSeconds = (juce::uint64)(unixMicros / 1000000) + 2208988800ull;
+      auto ntpFraction =
+          ((juce::uint64)(unixMicros % 1000000) << 32) / 1000000;
+      oscOut.beginTimedGroup(
+          juce::OSCTimeTag((ntpSeconds << 32) | ntpFraction));
+      sendSplitOscMessage(m, e.channel);
+      oscOut.endTimedGroup();
+      // Sample position = microseconds from nowMs
+      if (!blockMidiOut)
+        audioMidi.addEvent(
+            m, (int)juce::jmax<juce::int64>(0, e.timeMicros - now.count()));
+      break;
+    }
+    case AudioEvent::ReleaseNotes:
+      // After the outgoing file's last events, before the new file's
+      if (!audioMidi.isEmpty())
+        sendMidiBlock(audioMidi, nowMs);
+      audioMidi.clear();
+      releaseNotes();
+      break;
+    case AudioEvent::SyncStarted:
+      if (oscConnected)
+        oscOut.send(std::atomic_load(&oscAddresses)->play, 1.0f);
+      break;
+    case AudioEvent::TrackFinished:
+      postToMessageThread([this] {
+        if (onTrackFinished)
+          onTrackFinished();
+      });
+      break;
+    }
+  } while (audioEvents.pop(e));
+  if (!audioMidi.isEmpty())
+    sendMidiBlock(audioMidi, nowMs);
+}
+
+//==============================================================================
+// MIDI FILES
+//==============================================================================
+void BridgeEngine::loadFile(const juce::File &f, bool keepPlaying) {
+  if (!keepPlaying && playing)
+    stopPlayback();
+  fileLoader.load(f); // no lock held while parsing
+}
+
+void BridgeEngine::clearFile() {
+  // An empty file goes through the same swap path as a loaded one
+  setFile(std::make_shared<const LoadedMidiFile>());
+}
+
+void BridgeEngine::setFile(std::shared_ptr<const LoadedMidiFile> file) {
+  std::atomic_store(&pendingFile, std::move(file));
+}
+
+// Keeps nextFile holding the playlist entry after the one playing, parsed
+// and compiled, so Loop All can switch tracks without touching the disk
+void BridgeEngine::prefetch(const juce::String &path) {
+  {
+    const juce::SpinLock::ScopedLockType sl(prefetchLock);
+    if (path == prefetchPath && std::atomic_load(&nextFile) != nullptr)
+      return; // already parsed and not yet used
+    prefetchPath = path;
+    std::atomic_store(&nextFile, std::shared_ptr<const LoadedMidiFile>());
+  }
+  if (path.isNotEmpty())
+    prefetchLoader.load(juce::File(path));
+}
+
+//==============================================================================
+// CAPTURE / REPLAY
+//==============================================================================
+bool BridgeEngine::startCapture(const juce::File &file) {
+  if (!capture.start(file)) {
+    log("! Capture: cannot write " + file.getFullPathName());
+    return false;
+  }
+  log("Capture: recording to " + file.getFullPathName());
+  return true;
+}
+
+void BridgeEngine::stopCapture() {
+  if (!capture.isCapturing())
+    return;
+  capture.stop();
+  log("Capture: " + juce::String(capture.getRecordsWritten()) + " records, " +
+      juce::String(capture.getRecordsDropped()) + " dropped -> " +
+      capture.getFile().getFileName());
+}
+
+// Documents/PatchworldBridge/Captures/capture-<date>-<time>.pwcap
+juce::File BridgeEngine::getDefaultCaptureFile() {
+  return juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+      .getChildFile("PatchworldBridge/Captures")
+      .getChildFile(
+          "capture-" +
+          juce::Time::getCurrentTime().formatted("%Y%m%d-%H%M%S") +
+          ".pwcap");
+}
+
+// OSC inputs are sent to our own receive port so they take the same path
+// as live traffic; without an OSC connection only MIDI inputs replay.
+int BridgeEngine::startReplay(const juce::File &file) {
+  replayOscLoopback =
+      oscConnected && replaySender.connect("127.0.0.1", oscReceivePort);
+  int count = replayer.start(file);
+  if (count == 0) {
+    log("! Replay: no input records in " + file.getFileName());
+    return 0;
+  }
+  log("Replay: " + juce::String(count) + " inputs from " +
+      file.getFileName() +
+      (replayOscLoopback ? "" : " (MIDI only, OSC not connected)"));
+  return count;
+}
+
+//==============================================================================
+// AUDIO CLOCK
+//==============================================================================
+void BridgeEngine::setAudioClockEnabled(bool on) {
+  updateWallClockOffset();
+  audioClockEnabled = on;
+  log(on ? "Clock: Audio Device" : "Clock: Timer (1 ms)");
+}
+
+void BridgeEngine::prepareAudio(double sampleRate, int latencySamples) {
+  currentSampleRate = sampleRate;
+  audioSampleTime = 0.0;
+  hostTimeFilter.reset();
+  outputLatencySamples = latencySamples;
+  updateWallClockOffset();
+}
+
+void BridgeEngine::processAudioBlock(int numSamples) {
+  // Feed the sample clock -> host time filter every block so it has settled
+  // by the time audio clock mode is switched on
+  auto hostTime = hostTimeFilter.sampleTimeToHostTime(audioSampleTime);
+  audioSampleTime += numSamples;
+  if (!audioClockEnabled)
+    return;
+
+  auto toMicros = [this](double samples) {
+    return std::chrono::microseconds(
+        (juce::int64)std::llround(1.0e6 * samples / currentSampleRate));
+  };
+  auto &t = audioBlockTiming;
+  t.blockStart = hostTime + toMicros(outputLatencySamples);
+
+  auto session = link.captureAudioSessionState();
+  bool sessionChanged = false;
+  {
+    // Never waits for the message thread: a block that finds the lock
+    // taken plays nothing, and the next one picks up its events
+    const juce::ScopedTryLock sl(midiLock);
+    if (sl.isLocked())
+      sessionChanged =
+          processPlayback(session, t.blockStart + toMicros(numSamples), &t);
+  }
+  if (sessionChanged)
+    link.commitAudioSessionState(session);
+}
+
+// Link clock -> Unix time, for OSC time tags. juce::Time only has
+// millisecond resolution, so this is sampled when the device starts and
+// when the mode is switched on; spacing between events stays exact.
+void BridgeEngine::updateWallClockOffset() {
+  wallClockOffsetMicros =
+      juce::Time::currentTimeMillis() * 1000 - link.clock().micros().count();
+}
+
+//==============================================================================
+// STATUS
+//==============================================================================
+juce::String BridgeEngine::getStatsString() {
+  juce::String stats = "Peers: " + juce::String((int)link.numPeers());
+  if (oscOut.isEnabled())
+    stats << " | OSC Pkts Saved: " << oscOut.getPacketsSaved();
+  stats << " | Sched: " << noteScheduler.getDepth() << " (peak "
+        << noteScheduler.getPeakDepth() << ")";
+  // Handoffs that found their queue full and were lost
+  stats << " | Q Dropped: "
+        << oscToMidiQueue.getDropped() + audioEvents.getDropped() +
+               oscToKeyboardQueue.getDropped() +
+               midiInToKeyboardQueue.getDropped() +
+               schedulerToKeyboardQueue.getDropped() +
+               replayToKeyboardQueue.getDropped();
+  stats << " | Held: " << oscNotes.count() << " OSC, " << midiNotes.count()
+        << " MIDI";
+  if (capture.isCapturing())
+    stats << " | Capture: " << capture.getRecordsWritten();
+  stats << latency.toStatsString();
+  if (oscConnected)
+    stats << " | " << probe.getStatusString();
+  return stats;
+}
+
+void BridgeEngine::log(const juce::String &text) {
+  if (!onLog)
+    return;
+  LogEvent::pushText(text.toRawUTF8(), onLog);
+}
+
+void BridgeEngine::postToMessageThread(std::function<void()> fn) {
+  const auto postedMicros = LatencyHistogram::nowMicros();
+  juce::MessageManager::callAsync([this, postedMicros, fn = std::move(fn)] {
+    latency.callAsyncDelay.record(LatencyHistogram::nowMicros() -
+                                  postedMicros);
+    fn();
+  });
+}
@@ -0,0 +1,364 @@
+/*
+  ==============================================================================
+    Source/Core/BridgeEngine.h
+    OSC / MIDI / Link routing engine, independent of any window
+  ==============================================================================
+*/
+#pragma once
+#include "ActiveNotes.h"
+#include "Arpeggiator.h"
+#include "BridgeClock.h"
+#include "BridgeConfig.h"
+#include "ChannelMap.h"
+#include "EventLog.h"
+#include "LatencyHistogram.h"
+#include "MidiFileLoader.h"
+#include "NoteScheduler.h"
+#include "OscBundler.h"
+#include "OscEchoProbe.h"
+#include "OscRouting.h"
+#include "SpscQueue.h"
+#include "TrafficCapture.h"
+#include <ableton/Link.hpp>
+#include <ableton/link/HostTimeFilter.hpp>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <juce_osc/juce_osc.h>
+#include <memory>
+
+// Owns Link, the OSC and MIDI ports, the 1 ms scheduler and MIDI file
+// playback. The GUI drives it from MainComponent; headless mode drives it
+// straight from a BridgeConfig. Setters are for the message thread unless
+// noted; the routing options they change are atomics read by the network,
+// device and scheduler threads. Callbacks are set once before start().
+class BridgeEngine : private juce::MidiInputCallback,
+                     private juce::OSCReceiver::Listener<
+                         juce::OSCReceiver::RealtimeCallback>,
+                     private juce::HighResolutionTimer {
+public:
+  enum PlayMode { Single, LoopOne, LoopAll }; // as MidiPlaylist::PlayMode
+
+  // Notes routed off the message thread, for mirroring on a keyboard
+  struct KeyboardEcho {
+    int channel = 1;
+    int note = 0;
+    float velocity = 0.0f; // 0 = note off
+  };
+
+  BridgeEngine();
+  ~BridgeEngine() override;
+
+  void start();    // Link on (unless switched off), scheduler running
+  void shutdown(); // stops every engine thread; safe to call twice
+
+  // --- Callbacks ---
+  // Any thread, including the scheduler: must not block
+  std::function<void(const LogEvent &)> onLog;
+  // Scheduler thread, every tick: playback position in beats, and the
+  // resolution of the file that position is in (not the one on screen)
+  std::function<void(double beats, double ticksPerQuarterNote)> onPosition;
+  // Any sending thread, under the output lock. When set, MIDI output goes
+  // here instead of the open device (loopback benchmark's mock output).
+  std::function<void(const juce::MidiMessage &)> onMidiOut;
+  // Message thread
+  std::function<void(int fader, float value)> onVolumeReceived; // 1 or 2
+  std::function<void()> onPanic;
+  std::function<void()> onTrackFinished; // Loop All ran out of prefetch
+
+  // --- Configuration ---
+  void applyConfig(const BridgeConfig &config); // everything but the ports
+  void setOscAddresses(const OscAddresses &addresses);
+  void setChannelNames(const juce::StringArray &names); // 16, for {X}
+  void setChannelMap(const std::array<int, 16> &mapping,
+                     juce::uint32 activeMask);
+  void setOscBundling(bool shouldBundle, int maxBytes);
+  void setProbeSettings(int intervalMs, bool respond);
+  void setSplitEnabled(bool on) { splitEnabled = on; }
+  void setBlockMidiOut(bool on) { blockMidiOut = on; }
+  void setRetriggerEnabled(bool on) { retriggerEnabled = on; }
+  void setMidiChannel(int channelOr17ForAll) {
+    midiChannelSelection = channelOr17ForAll;
+  }
+  void setOctaveShift(int octaves) { virtualOctaveShift = octaves; }
+  int getOctaveShift() const { return virtualOctaveShift; }
+  void setPlaybackOctaveShift(int octaves) { pianoRollOctaveShift = octaves; }
+  int getPlaybackOctaveShift() const { return pianoRollOctaveShift; }
+  void setPlaylistMode(PlayMode mode) { playlistMode = mode; }
+  // Display echoes and traffic log entries cost nothing when switched off
+  void setKeyboardEchoes(bool on) { keyboardEchoes = on; }
+  void setTrafficLogging(bool on) { trafficLogging = on; }
+
+  // --- OSC ---
+  // False, with both ports closed, if either cannot be opened
+  bool connectOsc(const juce::String &ip, int sendPort, int receivePort);
+  void disconnectOsc();
+  bool isOscConnected() const { return oscConnected; }
+  void sendOsc(const juce::String &address, float value); // any thread
+  // MIDI -> OSC through the TX templates, channel map and split (any thread).
+  // direct: MIDI input only, through OscBundler::sendDirect().
+  void sendSplitOscMessage(const juce::MidiMessage &m, int overrideChannel = -1,
+                           bool direct = false);
+
+  // --- MIDI ---
+  // Empty identifier closes the port. False if the device can't be opened.
+  bool openMidiInput(const juce::String &identifier);
+  bool openMidiOutput(const juce::String &identifier);
+  // Identifier of the first device whose name matches, exactly or in part
+  static juce::String findMidiDevice(const juce::Array<juce::MidiDeviceInfo> &,
+                                     const juce::String &name);
+  void sendMidiNow(const juce::MidiMessage &m); // any thread
+  // Routed as if it came from the MIDI input device. One calling thread,
+  // and only while no input device is open (it shares the device's queue).
+  void receiveMidi(const juce::MidiMessage &m);
+  // Keyboard note routing: octave shift, split, OSC + MIDI out (any thread)
+  void routeNoteOn(int ch, int note, float vel, bool direct = false);
+  void routeNoteOff(int ch, int note, float vel, bool direct = false);
+
+  // --- Arpeggiator: steps on the scheduler thread, out to OSC and MIDI ---
+  // While latched, note-ons from the keyboard and MIDI input join the arp
+  // instead of sounding, and stay until the latch is switched off
+  void setArpLatched(bool on);
+  void setArpSync(bool on) { arpSync = on; } // lock steps to the Link beat
+  void setArpStepMs(double ms) { arpStepMs = juce::jmax(10.0, ms); }
+  void setArpVelocity(int velocity) {
+    arpVelocity = juce::jlimit(1, 127, velocity);
+  }
+  void setArpPattern(Arpeggiator::Pattern p) { arpPattern = p; }
+  void arpNoteOn(int ch, int note) { arp.noteOn(ch, note); } // any thread
+
+  // --- Transport / Link ---
+  void togglePlay(); // play, or pause when playing
+  void stop();
+  double tapTempo(); // the new tempo once enough taps came in, else 0
+  void setTempo(double bpm);
+  double getTempo();
+  void setQuantum(double beats) { quantum = beats; }
+  double getQuantum() const { return quantum; }
+  void setLinkEnabled(bool on);
+  ableton::Link &getLink() { return link; }
+  bool isPlaying() const { return playing; }
+  double getPlaybackBeats() const { return positionBeats; }
+  void panic();
+  // Note-offs for exactly the notes left sounding on the given channels
+  // (bit 0 = channel 1) of both outputs, OSC offs bundled into as few
+  // packets as the bundle size allows. Any thread.
+  void releaseNotes(juce::uint32 channels = 0xffff);
+
+  // --- MIDI files ---
+  void loadFile(const juce::File &f, bool keepPlaying = false);
+  void clearFile();
+  // An already parsed file, going live at the same swap point as loadFile's
+  void setFile(std::shared_ptr<const LoadedMidiFile> file);
+  void prefetch(const juce::String &path); // Loop All's next entry, or ""
+  // The file playback is on now; changes at the swap points
+  std::shared_ptr<const LoadedMidiFile> getPlayingFile() const {
+    return std::atomic_load(&playingFile);
+  }
+
+  // --- Capture / replay ---
+  bool startCapture(const juce::File &file);
+  void stopCapture();
+  const TrafficCapture &getCapture() const { return capture; }
+  static juce::File getDefaultCaptureFile();
+  int startReplay(const juce::File &file); // number of inputs, 0 = nothing
+  void stopReplay() { replayer.stop(); }
+  bool isReplaying() const { return replayer.isReplaying(); }
+  bool isReplayingOsc() const { return replayOscLoopback; }
+
+  // --- Audio clock mode: the audio callback drives playback ---
+  void setAudioClockEnabled(bool on);
+  bool isAudioClockEnabled() const { return audioClockEnabled; }
+  void prepareAudio(double sampleRate, int outputLatencySamples); // audio
+  void processAudioBlock(int numSamples);                         // audio
+
+  // --- Offline render: see OfflineRender ---
+  // Swaps the time source of the transport, scheduler and playback (nullptr
+  // restores Link's clock). Only on an engine whose timer is not running.
+  void setClock(BridgeClock *c) { schedulerClock = c ? c : &linkClock; }
+  // OSC output goes to `sink` instead of the socket and counts as connected
+  void setOscSink(std::function<void(const juce::OSCMessage &)> sink);
+  // One scheduler tick on the calling thread, for an engine that was never
+  // start()ed: the caller advances its clock between ticks
+  void runSchedulerTick() { hiResTimerCallback(); }
+
+  // --- Display ---
+  // Message thread: hands every echoed note to fn(const KeyboardEcho &)
+  template <typename Fn> void drainKeyboardEchoes(Fn &&fn) {
+    KeyboardEcho e;
+    for (auto *queue : {&oscToKeyboardQueue, &midiInToKeyboardQueue,
+                        &schedulerToKeyboardQueue, &replayToKeyboardQueue})
+      while (queue->pop(e))
+        fn(static_cast<const KeyboardEcho &>(e));
+  }
+  juce::String getStatsString();
+  juce::String getLatencyJson() const { return latency.toJson(); }
+
+  void log(const juce::String &text); // status line, any thread
+  // callAsync, plus the time the call waited in the message queue
+  void postToMessageThread(std::function<void()> fn);
+
+private:
+  // --- Audio clock mode ---
+  // Events are stamped against the device clock instead of the 1 ms timer.
+  // The audio thread only stamps and queues them; the scheduler thread
+  // sends them (MIDI via the output's timed queue, OSC via bundle time
+  // tags), along with anything else playback would have done there.
+  struct AudioBlockTiming {
+    std::chrono::microseconds blockStart{0}; // Link time of first sample out
+  };
+  struct AudioEvent {
+    enum Kind : juce::uint8 { Play, ReleaseNotes, SyncStarted, TrackFinished };
+    Kind kind = Play;
+    juce::uint8 channel = 0; // Play: OSC channel
+    RawMidi midi;            // Play: as it goes out on MIDI
+    juce::int64 timeMicros = 0; // Play: Link time it is due
+  };
+  struct TimedMidi {
+    RawMidi midi;
+    juce::int64 receivedMicros = 0; // LatencyHistogram::nowMicros()
+  };
+
+  void handleIncomingMidiMessage(juce::MidiInput *,
+                                 const juce::MidiMessage &) override;
+  void oscMessageReceived(const juce::OSCMessage &) override;
+  void hiResTimerCallback() override;
+  void processSchedulerTick();
+  void processArp(const ableton::Link::SessionState &session,
+                  std::chrono::microseconds now, double nowMs);
+  bool processPlayback(ableton::Link::SessionState &session,
+                       std::chrono::microseconds now,
+                       AudioBlockTiming *timing);
+  void deferToScheduler(AudioEvent::Kind kind) { audioEvents.push({kind}); }
+  void sendAudioEvents();
+  void emitPlaybackEvent(const juce::MidiMessage &m, int ch, double eventBeat,
+                         const ableton::Link::SessionState &session,
+                         double quantum, AudioBlockTiming *timing);
+  void routeMidiInput(const juce::MidiMessage &m,
+                      SpscQueue<KeyboardEcho, 1024> &echoQueue);
+  void echo(SpscQueue<KeyboardEcho, 1024> &queue, int ch, int note,
+            float velocity) {
+    if (keyboardEchoes)
+      queue.push({ch, note, velocity});
+  }
+  void logEvent(const LogEvent &e) {
+    if (trafficLogging && onLog)
+      onLog(e);
+  }
+  void stopPlayback();
+  void rebuildOscDispatch();
+  void rebuildOscTxCache();
+  void sendMidiBlock(const juce::MidiBuffer &block, double startMs);
+  void releaseOscNotes(juce::uint32 channels); // OSC destination channels
+  void releaseMidiNotes(int ch, int lowest, int highest);
+  void updateWallClockOffset();
+
+  ableton::Link link{120.0};
+  std::atomic<bool> linkWanted{true}; // what start() enables
+  LinkClock linkClock{link};
+  BridgeClock *schedulerClock = &linkClock; // set before anything runs
+  std::atomic<double> quantum{4.0}; // transport start/stop alignment
+
+  TrafficCapture capture; // before everything whose threads record into it
+  BridgeLatency latency;  // same
+  std::unique_ptr<juce::MidiInput> midiInput;
+  std::unique_ptr<juce::MidiOutput> midiOutput;
+  juce::CriticalSection midiOutLock; // guards midiOutput swaps vs. sends
+  juce::OSCSender oscSender;
+  OscBundler oscOut{oscSender}; // all outgoing OSC goes through here
+  juce::OSCReceiver oscReceiver;
+  std::shared_ptr<const OscDispatchTable> oscDispatch; // atomic_load/store
+  std::shared_ptr<const OscAddressCache> oscTxCache; // atomic_load/store only
+  std::shared_ptr<const OscAddresses> oscAddresses;  // atomic_load/store only
+  juce::StringArray channelNames;                    // message thread
+  std::atomic<bool> oscConnected{false};
+  int oscReceivePort = 0;
+  OscEchoProbe probe; // after oscOut, which its thread sends through
+  std::atomic<int> probeIntervalMs{1000};
+  std::atomic<bool> answerPings{false};
+
+  // OSC receiver thread -> scheduler thread (MIDI out) and -> message thread
+  // (keyboard display). Each queue has exactly one producer and one consumer.
+  SpscQueue<TimedMidi, 1024> oscToMidiQueue;
+  SpscQueue<KeyboardEcho, 1024> oscToKeyboardQueue;
+  SpscQueue<KeyboardEcho, 1024> midiInToKeyboardQueue; // MIDI device thread
+  SpscQueue<KeyboardEcho, 1024> schedulerToKeyboardQueue; // scheduler thread
+  SpscQueue<KeyboardEcho, 1024> replayToKeyboardQueue;    // replay thread
+
+  // Capture replay: OSC inputs loop back through oscReceiver via
+  // replaySender; MIDI inputs are routed directly on the replay thread
+  juce::OSCSender replaySender;
+  std::atomic<bool> replayOscLoopback{false};
+  CaptureReplayer replayer; // after replaySender, which its thread uses
+
+  // Routing options, read by the MIDI, OSC and scheduler threads
+  std::atomic<bool> splitEnabled{false}, arpLatched{false},
+      blockMidiOut{false}, retriggerEnabled{false};
+  std::atomic<bool> keyboardEchoes{true}, trafficLogging{true};
+  std::atomic<int> midiChannelSelection{17}; // 17 = All
+  std::atomic<int> virtualOctaveShift{0}, pianoRollOctaveShift{0};
+  ChannelMap channelMap; // mixer strip order and mutes
+  // Notes sounding per destination, kept by every send path
+  ActiveNotes oscNotes, midiNotes;
+
+  // Playback state. Before the loaders, whose threads can still take it
+  // while they are destroyed.
+  juce::CriticalSection midiLock;
+
+  // Loader thread -> pendingFile -> (playback swap) -> playingFile -> UI.
+  // All three shared_ptrs are only accessed with atomic_load/store/exchange.
+  std::shared_ptr<const LoadedMidiFile> pendingFile, playingFile;
+  const LoadedMidiFile *activeFile = nullptr; // playback, under midiLock
+  std::atomic<double> playingTicksPerQuarter{960.0}; // of activeFile
+  void setActiveFile(const LoadedMidiFile *f) { // under midiLock
+    activeFile = f;
+    if (f != nullptr)
+      playingTicksPerQuarter = f->ticksPerQuarterNote;
+  }
+  double pendingSwapBeat = -1.0;
+  MidiFileLoader fileLoader; // after pendingFile: its thread stores into it
+
+  // Loop All: the next playlist entry, parsed ahead of time
+  std::shared_ptr<const LoadedMidiFile> nextFile; // atomic access only
+  juce::String prefetchPath; // under prefetchLock, vs. the loader thread
+  juce::SpinLock prefetchLock;
+  std::atomic<int> playlistMode{Single};
+  bool skipRequested = false; // playback, under midiLock
+  MidiFileLoader prefetchLoader;
+
+  // Playback position, under midiLock
+  int playbackCursor = 0;
+  std::atomic<bool> playing{false};
+  double lastProcessedBeat = -1.0;
+  double transportStartBeat = 0.0;
+  double beatsPlayedOnPause = 0.0;
+  bool pendingSyncStart = false;
+  std::atomic<double> positionBeats{0.0}; // for the piano roll cursor
+
+  std::vector<double> tapTimes;
+
+  std::atomic<bool> audioClockEnabled{false};
+  ableton::link::HostTimeFilter<ableton::Link::Clock> hostTimeFilter;
+  double currentSampleRate = 44100.0;
+  double audioSampleTime = 0.0;
+  std::atomic<int> outputLatencySamples{0};
+  std::atomic<juce::int64> wallClockOffsetMicros{0};
+  AudioBlockTiming audioBlockTiming; // audio thread only
+  SpscQueue<AudioEvent, 4096> audioEvents; // audio -> scheduler thread
+  juce::MidiBuffer audioMidi; // scheduler thread, sendAudioEvents()
+
+  // Future note-ons and timed releases, drained every scheduler tick
+  NoteScheduler noteScheduler;
+
+  Arpeggiator arp;
+  std::atomic<bool> arpSync{false};
+  std::atomic<double> arpStepMs{400.0}; // free running; nearest division
+                                        // of a beat with sync on
+  std::atomic<int> arpVelocity{90};
+  std::atomic<int> arpPattern{Arpeggiator::Up};
+  double arpNextStepMs = -1.0;  // scheduler thread
+  juce::int64 arpLastStep = -1; // same, sync mode
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BridgeEngine)
+};
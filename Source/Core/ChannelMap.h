@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+    Source/Core/ChannelMap.h
+    Mixer channel mapping and mutes as seen by the routing threads
+  ==============================================================================
+*/
+#pragma once
+#include <array>
+#include <atomic>
+#include <juce_core/juce_core.h>
+
+// Source channel -> output channel (the mixer's strip order) plus one
+// "active" bit per output channel. Written from the message thread when the
+// mixer changes; read lock-free by the OSC, MIDI and scheduler threads.
+// Channels outside 1-16 pass through unmapped and count as active.
+class ChannelMap {
+public:
+  ChannelMap() {
+    for (int i = 0; i < 16; ++i)
+      mapping[(size_t)i] = i + 1;
+  }
+
+  void set(const std::array<int, 16> &newMapping, juce::uint32 activeMask) {
+    for (size_t i = 0; i < newMapping.size(); ++i)
+      mapping[i] = newMapping[i];
+    active = activeMask;
+  }
+
+  int map(int sourceCh) const {
+    if (sourceCh < 1 || sourceCh > 16)
+      return sourceCh;
+    return mapping[(size_t)sourceCh - 1];
+  }
+
+  juce::uint32 getActiveMask() const { return active; }
+
+  bool isActive(int ch) const {
+    if (ch < 1 || ch > 16)
+      return true;
+    return (active.load() >> (ch - 1)) & 1u;
+  }
+
+private:
+  std::array<std::atomic<int>, 16> mapping;
+  std::atomic<juce::uint32> active{0xffff};
+};
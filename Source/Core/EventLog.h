@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+    Source/Core/EventLog.h
+    Compact traffic log records, formatted only when shown or exported
+  ==============================================================================
+*/
+#pragma once
+#include <cstring>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <type_traits>
+
+// One line of the traffic log as a 64-byte POD. The hot paths (playback,
+// MIDI and OSC threads) fill in numbers and at most a short copy of an OSC
+// address; turning it into text is left to whoever displays or exports it.
+// Status lines don't fit one record: pushText() spreads them over as many
+// Text records as they need and LogTextJoiner puts them back together.
+struct LogEvent {
+  enum Kind : juce::uint8 {
+    Text,       // status line chunk: data1 = index, data2 = 1 if more follow
+    NoteOn,     // data1 note, data2 velocity
+    NoteOff,    // data1 note
+    Controller, // data1 controller, data2 value
+    PitchBend,  // value = 14-bit bend
+    Midi,       // any other channel message, data1/data2 raw
+    Osc         // text = address, value = first float argument
+  };
+  enum Direction : juce::uint8 { Internal, In, Out };
+
+  static constexpr int maxTextBytes = 46;
+  static constexpr int maxTextChunks = 256; // longer lines are cut
+  // One for every pushText() caller, whatever it pushes through
+  inline static juce::SpinLock textLock;
+
+  juce::int64 timeMicros = 0; // getMillisecondCounterHiRes() * 1000
+  float value = 0.0f;
+  Kind kind = Text;
+  Direction direction = Internal;
+  juce::uint8 channel = 0, data1 = 0, data2 = 0;
+  juce::uint8 textLength = 0;
+  char text[maxTextBytes] = {};
+
+  static juce::int64 nowMicros() {
+    return (juce::int64)(juce::Time::getMillisecondCounterHiRes() * 1000.0);
+  }
+
+  static LogEvent make(Kind kind, Direction dir, int channel = 0,
+                       int data1 = 0, int data2 = 0) {
+    LogEvent e;
+    e.timeMicros = nowMicros();
+    e.kind = kind;
+    e.direction = dir;
+    e.channel = (juce::uint8)channel;
+    e.data1 = (juce::uint8)data1;
+    e.data2 = (juce::uint8)data2;
+    return e;
+  }
+
+  // Truncates; a partial UTF-8 sequence at the cut is dropped on display
+  void setText(const char *utf8) {
+    auto n = juce::jmin(std::strlen(utf8), (size_t)maxTextBytes);
+    std::memcpy(text, utf8, n);
+    textLength = (juce::uint8)n;
+  }
+
+  juce::String getText() const {
+    return juce::String::fromUTF8(text, (int)textLength);
+  }
+
+  // Calls push(const LogEvent &) for each Text record of `utf8`, every
+  // chunk cut on a character boundary. Not for the hot paths: textLock
+  // keeps the chunks of lines from different threads from interleaving.
+  template <typename Fn> static void pushText(const char *utf8, Fn &&push) {
+    const juce::SpinLock::ScopedLockType sl(textLock);
+    auto remaining = std::strlen(utf8);
+    for (int index = 0;; ++index) {
+      auto n = juce::jmin(remaining, (size_t)maxTextBytes);
+      if (n < remaining)
+        while (n > 0 && (utf8[n] & 0xc0) == 0x80)
+          --n;
+      const bool more = n < remaining && index + 1 < maxTextChunks;
+      auto e = make(Text, Internal, 0, index, more ? 1 : 0);
+      std::memcpy(e.text, utf8, n);
+      e.textLength = (juce::uint8)n;
+      push(static_cast<const LogEvent &>(e));
+      if (!more)
+        return;
+      utf8 += n;
+      remaining -= n;
+    }
+  }
+
+  // Log panel line. Kept to the wording the panel always used. `line` is
+  // the whole status line for a joined Text record.
+  juce::String toDisplayString() const { return toDisplayString(getText()); }
+  juce::String toDisplayString(const juce::String &line) const {
+    switch (kind) {
+    case Text:
+      return "! " + line;
+    case NoteOn:
+      return "! Note On: " + juce::String(data1);
+    case NoteOff:
+      return "! Note Off: " + juce::String(data1);
+    case Controller:
+      return "! Ch" + juce::String(channel) + " CC" + juce::String(data1) +
+             ": " + juce::String(data2);
+    case PitchBend:
+      return "! Ch" + juce::String(channel) + " Bend: " +
+             juce::String((int)value);
+    case Midi:
+      return "! Ch" + juce::String(channel) + " MIDI " + juce::String(data1) +
+             " " + juce::String(data2);
+    case Osc:
+      return "! " + getText() + " " + juce::String(value, 2);
+    }
+    return {};
+  }
+
+  // Export line: time, direction and the raw fields, tab separated
+  juce::String toExportString() const { return toExportString(getText()); }
+  juce::String toExportString(const juce::String &line) const {
+    static const char *const directions[] = {"-", "in", "out"};
+    static const char *const kinds[] = {"text", "note_on", "note_off", "cc",
+                                        "bend", "midi",    "osc"};
+    return juce::String((double)timeMicros / 1000.0, 3) + "\t" +
+           directions[direction] + "\t" + kinds[kind] + "\t" +
+           juce::String(channel) + "\t" + juce::String(data1) + "\t" +
+           juce::String(data2) + "\t" + juce::String(value) + "\t" + line;
+  }
+};
+static_assert(std::is_trivially_copyable<LogEvent>::value,
+              "LogEvent must stay POD");
+static_assert(sizeof(LogEvent) == 64, "LogEvent should stay one cache line");
+
+// Consumer side of LogEvent::pushText(), on the thread that drains
+class LogTextJoiner {
+public:
+  // True once `e` ends a status line, which is then in `line`. A line that
+  // lost a chunk to a full ring is dropped rather than shown garbled.
+  bool add(const LogEvent &e, juce::String &line) {
+    if (e.data1 == 0)
+      pending.clear();
+    else if (e.data1 != nextIndex) {
+      nextIndex = -1;
+      return false;
+    }
+    pending += e.getText();
+    nextIndex = e.data1 + 1;
+    if (e.data2 != 0)
+      return false;
+    line = std::move(pending);
+    pending.clear();
+    nextIndex = -1;
+    return true;
+  }
+
+private:
+  juce::String pending;
+  int nextIndex = -1;
+};
@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+    Source/Core/LatencyHistogram.h
+    Lock-free log-linear latency histograms for the bridge paths
+  ==============================================================================
+*/
+#pragma once
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <juce_core/juce_core.h>
+
+// HDR-style histogram of microsecond values: exact below 64 us, then 32
+// linear sub-buckets per power of two (about 3% resolution) up to weeks.
+// record() is a couple of relaxed atomic adds, safe from any thread
+// including the audio and scheduler threads; readers take a snapshot.
+class LatencyHistogram {
+public:
+  static constexpr int subBuckets = 32;
+  static constexpr int maxOctave = 36;
+  static constexpr int numBuckets = 2 * subBuckets + maxOctave * subBuckets;
+
+  struct Snapshot {
+    juce::int64 count = 0;
+    juce::int64 p50 = 0, p99 = 0, p999 = 0, max = 0; // microseconds
+
+    // "0.42/1.10/2.00/3.21ms", or "--" with no samples
+    juce::String toShortString() const {
+      if (count == 0)
+        return "--";
+      auto ms = [](juce::int64 us) { return juce::String(us / 1000.0, 2); };
+      return ms(p50) + "/" + ms(p99) + "/" + ms(p999) + "/" + ms(max) + "ms";
+    }
+
+    juce::var toVar() const {
+      auto *o = new juce::DynamicObject();
+      o->setProperty("count", count);
+      o->setProperty("p50_us", p50);
+      o->setProperty("p99_us", p99);
+      o->setProperty("p999_us", p999);
+      o->setProperty("max_us", max);
+      return juce::var(o);
+    }
+  };
+
+  static juce::int64 nowMicros() {
+    return (juce::int64)(juce::Time::getMillisecondCounterHiRes() * 1000.0);
+  }
+
+  // Negative values (clock skew between domains) count as zero
+  void record(juce::int64 micros) {
+    auto v = (juce::uint64)juce::jmax<juce::int64>(0, micros);
+    buckets[(size_t)bucketFor(v)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    auto prev = maxValue.load(std::memory_order_relaxed);
+    while ((juce::int64)v > prev &&
+           !maxValue.compare_exchange_weak(prev, (juce::int64)v,
+                                           std::memory_order_relaxed)) {
+    }
+  }
+
+  Snapshot getSnapshot() const {
+    std::array<juce::int64, numBuckets> counts;
+    Snapshot s;
+    for (int i = 0; i < numBuckets; ++i) {
+      counts[(size_t)i] = buckets[(size_t)i].load(std::memory_order_relaxed);
+      s.count += counts[(size_t)i];
+    }
+    if (s.count == 0)
+      return s;
+    s.max = maxValue.load(std::memory_order_relaxed);
+    s.p50 = valueAtQuantile(counts, s.count, 0.5, s.max);
+    s.p99 = valueAtQuantile(counts, s.count, 0.99, s.max);
+    s.p999 = valueAtQuantile(counts, s.count, 0.999, s.max);
+    return s;
+  }
+
+  // Not synchronised with concurrent record(); a sample racing a reset may
+  // land in either window
+  void reset() {
+    for (auto &b : buckets)
+      b.store(0, std::memory_order_relaxed);
+    total = 0;
+    maxValue = 0;
+  }
+
+  juce::int64 getCount() const { return total; }
+
+private:
+  static int bucketFor(juce::uint64 v) {
+    if (v < (juce::uint64)(2 * subBuckets))
+      return (int)v;
+    int octave = juce::jmin(63 - countLeadingZeros(v) - 5, maxOctave);
+    auto sub = (int)(v >> octave) - subBuckets; // 32..63 -> 0..31
+    return juce::jmin(numBuckets - 1,
+                      2 * subBuckets + (octave - 1) * subBuckets + sub);
+  }
+
+  // Upper edge of a bucket, so percentiles never under-report
+  static juce::int64 bucketTop(int index) {
+    if (index < 2 * subBuckets)
+      return index;
+    int octave = (index - 2 * subBuckets) / subBuckets + 1;
+    int sub = (index - 2 * subBuckets) % subBuckets + subBuckets;
+    return ((juce::int64)(sub + 1) << octave) - 1;
+  }
+
+  static int countLeadingZeros(juce::uint64 v) {
+    int n = 0;
+    for (auto bit = (juce::uint64)1 << 63; (v & bit) == 0; bit >>= 1)
+      ++n;
+    return n;
+  }
+
+  static juce::int64
+  valueAtQuantile(const std::array<juce::int64, numBuckets> &counts,
+                  juce::int64 count, double q, juce::int64 max) {
+    auto rank = (juce::int64)std::ceil(q * (double)count);
+    juce::int64 seen = 0;
+    for (int i = 0; i < numBuckets; ++i) {
+      seen += counts[(size_t)i];
+      if (seen >= rank)
+        return juce::jmin(bucketTop(i), max);
+    }
+    return max;
+  }
+
+  std::array<std::atomic<juce::uint32>, numBuckets> buckets{};
+  std::atomic<juce::int64> total{0}, maxValue{0};
+};
+
+// The four measured paths through the bridge
+struct BridgeLatency {
+  LatencyHistogram oscToMidi;         // OSC packet received -> MIDI sent
+  LatencyHistogram midiToOsc;         // MIDI input -> OSC handed to sender
+  LatencyHistogram schedulerLateness; // event due time -> actually sent
+  LatencyHistogram callAsyncDelay;    // callAsync posted -> run on UI thread
+
+  void reset() {
+    oscToMidi.reset();
+    midiToOsc.reset();
+    schedulerLateness.reset();
+    callAsyncDelay.reset();
+  }
+
+  // Stats bar: p50/p99/p999/max per path that has samples
+  juce::String toStatsString() const {
+    juce::String s;
+    auto add = [&s](const char *name, const LatencyHistogram &h) {
+      auto snap = h.getSnapshot();
+      if (snap.count > 0)
+        s << " | " << name << " " << snap.toShortString();
+    };
+    add("OSC>MIDI", oscToMidi);
+    add("MIDI>OSC", midiToOsc);
+    add("Sched late", schedulerLateness);
+    add("UI queue", callAsyncDelay);
+    return s;
+  }
+
+  juce::String toJson() const {
+    auto *o = new juce::DynamicObject();
+    o->setProperty("osc_to_midi", oscToMidi.getSnapshot().toVar());
+    o->setProperty("midi_to_osc", midiToOsc.getSnapshot().toVar());
+    o->setProperty("scheduler_lateness",
+                   schedulerLateness.getSnapshot().toVar());
+    o->setProperty("callasync_delay", callAsyncDelay.getSnapshot().toVar());
+    return juce::JSON::toString(juce::var(o));
+  }
+};
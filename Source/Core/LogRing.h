@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+    Source/Core/LogRing.h
+    Lossy lock-free multi-producer ring of POD records
+  ==============================================================================
+*/
+#pragma once
+#include <array>
+#include <atomic>
+#include <juce_core/juce_core.h>
+#include <type_traits>
+
+// Any number of threads push trivially copyable records; one consumer (the
+// UI timer) drains them. Writers claim a sequence number with a single
+// fetch_add and copy into the slot, so a push never locks or allocates.
+// Each slot carries a seqlock stamp: odd while being written, 2 * (seq + 1)
+// once complete. When writers lap the reader the oldest records are
+// overwritten and counted as dropped rather than blocking anyone; a writer
+// that finds its slot still busy leaves a tombstone so the reader skips it.
+template <typename T, int Capacity = 1024> class LogRing {
+public:
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "LogRing records must be POD");
+
+  void push(const T &item) {
+    auto seq = head.fetch_add(1, std::memory_order_relaxed);
+    auto &slot = slots[(size_t)(seq & (Capacity - 1))];
+
+    // Another writer inside this slot, or one from a later lap already
+    // done with it: drop, don't wait. The tombstone tells the reader this
+    // sequence number will never be written, so it counts the gap and
+    // moves on instead of waiting for it.
+    auto stamp = slot.stamp.load(std::memory_order_relaxed);
+    if ((stamp & 1) != 0 || stamp > 2 * seq ||
+        !slot.stamp.compare_exchange_strong(stamp, 2 * seq + 1,
+                                            std::memory_order_acquire)) {
+      slot.skipped.store(seq + 1, std::memory_order_release);
+      return;
+    }
+    slot.item = item;
+    slot.stamp.store(2 * seq + 2, std::memory_order_release);
+  }
+
+  // Consumer only. Calls fn(const T &) for every complete record since the
+  // last call, oldest first. Stops at a record that is still being written;
+  // it is picked up next time.
+  template <typename Fn> void drain(Fn &&fn) {
+    auto end = head.load(std::memory_order_acquire);
+    if (end - readSeq > (juce::uint64)Capacity) {
+      dropped += (int)(end - Capacity - readSeq);
+      readSeq = end - Capacity;
+    }
+
+    T item;
+    while (readSeq < end) {
+      auto &slot = slots[(size_t)(readSeq & (Capacity - 1))];
+      auto before = slot.stamp.load(std::memory_order_acquire);
+      if (before < 2 * readSeq + 2) {
+        if (slot.skipped.load(std::memory_order_acquire) != readSeq + 1)
+          return; // not finished yet
+        ++dropped; // its writer gave up on the slot
+        ++readSeq;
+        continue;
+      }
+      if (before == 2 * readSeq + 2) {
+        item = slot.item;
+        std::atomic_thread_fence(std::memory_order_acquire);
+      }
+      if (before != 2 * readSeq + 2 ||
+          slot.stamp.load(std::memory_order_relaxed) != before)
+        ++dropped; // overwritten by a later lap while we looked
+      else
+        fn(static_cast<const T &>(item));
+      ++readSeq;
+    }
+  }
+
+  // Consumer only: forget everything pushed so far
+  void skipAll() { readSeq = head.load(std::memory_order_acquire); }
+
+  int getDropped() const { return dropped; }
+
+private:
+  struct Slot {
+    std::atomic<juce::uint64> stamp{0};
+    std::atomic<juce::uint64> skipped{0}; // seq + 1 of a dropped push
+    T item{};
+  };
+
+  std::array<Slot, (size_t)Capacity> slots;
+  std::atomic<juce::uint64> head{0};
+  juce::uint64 readSeq = 0; // consumer only
+  std::atomic<int> dropped{0};
+};
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+    Source/Core/MidiFileLoader.h
+    Off-thread .mid parsing into an immutable, shareable result
+  ==============================================================================
+*/
+#pragma once
+#include "MidiTimeline.h"
+#include "NoteIndex.h"
+#include <atomic>
+#include <functional>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <memory>
+
+// Everything playback and the UI need from one file. Built once on the
+// loader thread and never modified afterwards, so it can be handed between
+// threads as a shared_ptr<const>.
+struct LoadedMidiFile {
+  juce::File file;
+  MidiTimeline timeline; // playback
+  NoteIndex notes;       // piano roll
+  double ticksPerQuarterNote = 960.0;
+  double fileBpm = 0.0; // first tempo event, 0 if none
+  int numTracks = 0;
+
+  // nullptr if the file can't be opened or isn't a Standard MIDI File
+  static std::shared_ptr<const LoadedMidiFile> parse(const juce::File &f) {
+    juce::FileInputStream stream(f);
+    if (!stream.openedOk())
+      return nullptr;
+    juce::MidiFile mf;
+    if (!mf.readFrom(stream))
+      return nullptr;
+
+    auto result = std::make_shared<LoadedMidiFile>();
+    result->file = f;
+    result->numTracks = mf.getNumTracks();
+    // SMPTE time formats are negative; only PPQ files are supported
+    if (mf.getTimeFormat() > 0)
+      result->ticksPerQuarterNote = (double)mf.getTimeFormat();
+
+    juce::MidiMessageSequence sequence; // all tracks merged
+    for (int i = 0; i < mf.getNumTracks(); ++i) {
+      auto *track = mf.getTrack(i);
+      sequence.addSequence(*track, 0);
+      if (result->fileBpm <= 0.0)
+        for (auto *ev : *track)
+          if (ev->message.isTempoMetaEvent()) {
+            result->fileBpm =
+                60.0 / ev->message.getTempoSecondsPerQuarterNote();
+            break;
+          }
+    }
+    sequence.updateMatchedPairs();
+    result->timeline =
+        MidiTimeline::compile(sequence, result->ticksPerQuarterNote);
+    result->notes = NoteIndex::build(sequence);
+    return result;
+  }
+};
+
+// Single worker thread that parses files in request order. Only the most
+// recent request is delivered; a result overtaken by a newer load() is
+// dropped.
+class MidiFileLoader {
+public:
+  ~MidiFileLoader() { pool.removeAllJobs(true, 5000); }
+
+  // Runs on the loader thread. file is nullptr if parsing failed.
+  std::function<void(std::shared_ptr<const LoadedMidiFile> file,
+                     const juce::File &source)>
+      onLoaded;
+
+  void load(const juce::File &f) {
+    int gen = ++generation;
+    pool.addJob([this, f, gen] {
+      auto result = LoadedMidiFile::parse(f);
+      if (gen == generation && onLoaded)
+        onLoaded(std::move(result), f);
+    });
+  }
+
+private:
+  std::atomic<int> generation{0};
+  juce::ThreadPool pool{1};
+};
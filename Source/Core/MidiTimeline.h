@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+    Source/Core/MidiTimeline.h
+    Flat, pre-timed event array compiled from a loaded MIDI file
+  ==============================================================================
+*/
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <type_traits>
+#include <vector>
+
+// One channel voice message with its position already in beats. 16 bytes,
+// trivially copyable, so playback walks a contiguous array.
+struct TimelineEvent {
+  double beat = 0.0;
+  juce::uint8 status = 0, data1 = 0, data2 = 0, size = 0;
+
+  int getChannel() const { return (status & 0x0f) + 1; }
+  bool isNoteOnOrOff() const {
+    auto type = status & 0xf0;
+    return type == 0x80 || type == 0x90;
+  }
+  bool isNoteOn() const { return (status & 0xf0) == 0x90 && data2 > 0; }
+
+  // Short messages live inside MidiMessage itself, no allocation
+  juce::MidiMessage toMessage(int noteShift = 0) const {
+    auto d1 = data1;
+    if (isNoteOnOrOff())
+      d1 = (juce::uint8)juce::jlimit(0, 127, data1 + noteShift);
+    return size == 2 ? juce::MidiMessage(status, d1)
+                     : juce::MidiMessage(status, d1, data2);
+  }
+};
+static_assert(std::is_trivially_copyable<TimelineEvent>::value,
+              "TimelineEvent must stay POD");
+
+class MidiTimeline {
+public:
+  // Keeps channel voice messages only; meta events (tempo, names) are read
+  // separately at load time and sysex is not played back.
+  static MidiTimeline compile(const juce::MidiMessageSequence &seq,
+                              double ticksPerQuarterNote) {
+    MidiTimeline t;
+    t.events.reserve((size_t)seq.getNumEvents());
+    for (auto *holder : seq) {
+      auto &m = holder->message;
+      auto *raw = m.getRawData();
+      int size = m.getRawDataSize();
+      if (size < 2 || size > 3 || raw[0] < 0x80 || raw[0] >= 0xf0)
+        continue;
+      TimelineEvent e;
+      e.beat = m.getTimeStamp() / ticksPerQuarterNote;
+      e.status = raw[0];
+      e.data1 = raw[1];
+      e.data2 = size > 2 ? raw[2] : 0;
+      e.size = (juce::uint8)size;
+      t.events.push_back(e);
+    }
+    t.lengthBeats = seq.getEndTime() / ticksPerQuarterNote;
+    return t;
+  }
+
+  int size() const { return (int)events.size(); }
+  bool isEmpty() const { return events.empty(); }
+  const TimelineEvent &operator[](int i) const { return events[(size_t)i]; }
+  const TimelineEvent *begin() const { return events.data(); }
+  const TimelineEvent *end() const { return events.data() + events.size(); }
+  double getLengthBeats() const { return lengthBeats; }
+
+  void clear() {
+    events.clear();
+    lengthBeats = 0.0;
+  }
+
+private:
+  std::vector<TimelineEvent> events;
+  double lengthBeats = 0.0;
+};
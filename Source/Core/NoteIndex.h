@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+    Source/Core/NoteIndex.h
+    Start-sorted note intervals for windowed piano roll drawing
+  ==============================================================================
+*/
+#pragma once
+#include <algorithm>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <vector>
+
+struct NoteInterval {
+  double start = 0.0, end = 0.0; // ticks
+  juce::uint8 note = 0, channel = 1;
+};
+
+// Notes sorted by start tick, plus a running maximum of end ticks. A
+// window query binary-searches both arrays, so the cost is the number of
+// notes overlapping the window rather than the length of the file.
+class NoteIndex {
+public:
+  // Notes without a matching note-off are drawn this many ticks long
+  static constexpr double defaultLength = 240.0;
+
+  // seq must have had updateMatchedPairs() called
+  static NoteIndex build(const juce::MidiMessageSequence &seq) {
+    NoteIndex index;
+    index.notes.reserve((size_t)seq.getNumEvents() / 2);
+    for (auto *ev : seq) {
+      if (!ev->message.isNoteOn())
+        continue;
+      NoteInterval n;
+      n.start = ev->message.getTimeStamp();
+      n.end = ev->noteOffObject != nullptr
+                  ? ev->noteOffObject->message.getTimeStamp()
+                  : n.start + defaultLength;
+      n.note = (juce::uint8)ev->message.getNoteNumber();
+      n.channel = (juce::uint8)ev->message.getChannel();
+      index.notes.push_back(n);
+    }
+    std::stable_sort(index.notes.begin(), index.notes.end(),
+                     [](const NoteInterval &a, const NoteInterval &b) {
+                       return a.start < b.start;
+                     });
+
+    index.maxEndUpTo.reserve(index.notes.size());
+    double maxEnd = 0.0;
+    for (auto &n : index.notes) {
+      maxEnd = juce::jmax(maxEnd, n.end);
+      index.maxEndUpTo.push_back(maxEnd);
+    }
+    index.endTick = seq.getEndTime();
+    return index;
+  }
+
+  // Calls fn for every note overlapping [fromTick, toTick], in start order
+  template <typename Fn>
+  void forEachInWindow(double fromTick, double toTick, Fn &&fn) const {
+    // Before `first` every note has already ended
+    auto first = std::lower_bound(maxEndUpTo.begin(), maxEndUpTo.end(),
+                                  fromTick) -
+                 maxEndUpTo.begin();
+    auto last = std::upper_bound(notes.begin(), notes.end(), toTick,
+                                 [](double t, const NoteInterval &n) {
+                                   return t < n.start;
+                                 }) -
+                notes.begin();
+    for (auto i = first; i < last; ++i)
+      if (notes[(size_t)i].end >= fromTick)
+        fn(notes[(size_t)i]);
+  }
+
+  const std::vector<NoteInterval> &getNotes() const { return notes; }
+  int size() const { return (int)notes.size(); }
+  double getEndTick() const { return endTick; }
+
+private:
+  std::vector<NoteInterval> notes;
+  std::vector<double> maxEndUpTo; // maxEndUpTo[i] = max(end) of notes[0..i]
+  double endTick = 0.0;
+};
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+    Source/Core/NoteScheduler.h
+    Time-ordered note event queue for the high-resolution scheduler
+  ==============================================================================
+*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <juce_core/juce_core.h>
+#include <vector>
+
+struct ScheduledEvent {
+  enum Kind : juce::uint8 { NoteOn, NoteOff };
+  double timeMs = 0.0; // juce::Time::getMillisecondCounterHiRes() domain
+  juce::uint32 order = 0;
+  Kind kind = NoteOff;
+  juce::uint8 channel = 1, note = 0, velocity = 0;
+};
+
+// Binary min-heap on a preallocated vector: O(log n) insert and expire, no
+// allocation until the reserved capacity is exceeded. Any thread may
+// schedule; the scheduler thread pops. Equal times come out in insertion
+// order so a note-off queued before a retrigger stays ahead of it.
+class NoteScheduler {
+public:
+  explicit NoteScheduler(int capacity = 4096) {
+    heap.reserve((size_t)capacity);
+  }
+
+  void schedule(double timeMs, ScheduledEvent::Kind kind, int channel,
+                int note, int velocity = 0) {
+    ScheduledEvent e;
+    e.timeMs = timeMs;
+    e.kind = kind;
+    e.channel = (juce::uint8)juce::jlimit(1, 16, channel);
+    e.note = (juce::uint8)juce::jlimit(0, 127, note);
+    e.velocity = (juce::uint8)juce::jlimit(0, 127, velocity);
+
+    const juce::SpinLock::ScopedLockType sl(lock);
+    e.order = nextOrder++;
+    heap.push_back(e);
+    std::push_heap(heap.begin(), heap.end(), Later());
+    depth = (int)heap.size();
+    peakDepth = juce::jmax(peakDepth.load(), depth.load());
+  }
+
+  // Hands every event due at nowMs to fn, earliest first. fn runs outside
+  // the lock so it may schedule follow-up events.
+  template <typename Fn> void popDue(double nowMs, Fn &&fn) {
+    for (;;) {
+      ScheduledEvent e;
+      {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        if (heap.empty() || heap.front().timeMs > nowMs)
+          return;
+        std::pop_heap(heap.begin(), heap.end(), Later());
+        e = heap.back();
+        heap.pop_back();
+        depth = (int)heap.size();
+      }
+      fn(e);
+    }
+  }
+
+  void clear() {
+    const juce::SpinLock::ScopedLockType sl(lock);
+    heap.clear();
+    depth = 0;
+  }
+
+  // Queue depth metrics (lock-free reads for the stats bar)
+  int getDepth() const { return depth; }
+  int getPeakDepth() const { return peakDepth; }
+
+private:
+  struct Later {
+    bool operator()(const ScheduledEvent &a, const ScheduledEvent &b) const {
+      if (a.timeMs != b.timeMs)
+        return a.timeMs > b.timeMs;
+      return a.order > b.order;
+    }
+  };
+
+  juce::SpinLock lock;
+  std::vector<ScheduledEvent> heap;
+  juce::uint32 nextOrder = 0;
+  std::atomic<int> depth{0}, peakDepth{0};
+};
@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+    Source/Core/OfflineRender.h
+    Faster-than-realtime MIDI file playback into a timestamped event list
+  ==============================================================================
+*/
+#pragma once
+#include "BridgeClock.h"
+#include "BridgeConfig.h"
+#include "BridgeEngine.h"
+#include <chrono>
+#include <memory>
+
+// Plays a whole file through a BridgeEngine that runs on a VirtualClock:
+// the same transport, playback and routing as live (octave shift, split,
+// channel map, mutes), but with the scheduler ticked back to back on the
+// calling thread instead of once per millisecond. Everything the engine
+// sends is written as one text line per OSC message or MIDI event,
+//   <ms since start> OSC <address> <args...>
+//   <ms since start> MIDI <hex bytes>
+// so the same file and settings always produce the same output, byte for
+// byte (golden files, --render-check), and the wall time taken measures
+// routing throughput.
+class OfflineRender {
+public:
+  struct Result {
+    int oscMessages = 0, midiEvents = 0;
+    double renderedMs = 0.0; // virtual time covered
+    double wallMs = 0.0;     // time it took
+  };
+
+  // The routing settings of `config`; its ports, devices and Link are
+  // ignored, nothing leaves the process
+  explicit OfflineRender(const BridgeConfig &c) : config(c) {}
+
+  // tickMs: virtual time between scheduler ticks, 1 as live
+  Result render(std::shared_ptr<const LoadedMidiFile> file,
+                juce::OutputStream &out, double tickMs = 1.0) {
+    Result result;
+    VirtualClock clock(ableton::Link::Clock().micros());
+    BridgeEngine engine; // after the clock it reads
+    // A new Link timeline starts from the wall clock. Link does its beat
+    // math in whole microseconds and microbeats, so only a start at a fixed
+    // distance from that origin rounds the same way on every run: start on
+    // its beat 0, and pin beat 0 there again once the tempo is set.
+    const double quantum = engine.getQuantum();
+    clock.reset(engine.getLink().captureAppSessionState().timeAtBeat(
+        0.0, quantum));
+    engine.setClock(&clock);
+    engine.setKeyboardEchoes(false);
+    engine.setTrafficLogging(false);
+    auto routing = config;
+    routing.link = false; // no session to join, not even briefly
+    routing.probeMs = 0;
+    routing.loop = false; // play to the end once
+    engine.applyConfig(routing);
+    if (config.bpm <= 0.0 && file->fileBpm > 0.0)
+      engine.setTempo(file->fileBpm);
+    auto session = engine.getLink().captureAppSessionState();
+    session.forceBeatAtTime(0.0, clock.micros(), quantum);
+    engine.getLink().commitAppSessionState(session);
+
+    auto stamp = [&clock, &out] {
+      out << juce::String(clock.getElapsedMs(), 3);
+    };
+    engine.setOscSink([&](const juce::OSCMessage &m) {
+      stamp();
+      out << " OSC " << m.getAddressPattern().toString();
+      for (auto &arg : m)
+        if (arg.isFloat32())
+          out << juce::String::formatted(" %g", (double)arg.getFloat32());
+        else if (arg.isInt32())
+          out << " " << arg.getInt32();
+      out << "\n";
+      ++result.oscMessages;
+    });
+    engine.onMidiOut = [&](const juce::MidiMessage &m) {
+      stamp();
+      out << " MIDI "
+          << juce::String::toHexString(m.getRawData(), m.getRawDataSize())
+          << "\n";
+      ++result.midiEvents;
+    };
+
+    // Every file event plus a bar either side for the start and end
+    const double msPerBeat = 60000.0 / engine.getTempo();
+    const double limitMs =
+        (file->timeline.getLengthBeats() + 2.0 * quantum) * msPerBeat;
+    const auto step = std::chrono::microseconds(
+        (juce::int64)juce::jmax(1.0, tickMs * 1000.0));
+
+    const double wallStart = juce::Time::getMillisecondCounterHiRes();
+    engine.setFile(std::move(file));
+    engine.runSchedulerTick(); // stopped: the file goes live right away
+    engine.togglePlay();
+    while (engine.isPlaying() && clock.getElapsedMs() < limitMs) {
+      clock.advance(step);
+      engine.runSchedulerTick();
+    }
+    result.wallMs = juce::Time::getMillisecondCounterHiRes() - wallStart;
+    result.renderedMs = clock.getElapsedMs();
+    out.flush();
+    return result;
+  }
+
+private:
+  BridgeConfig config;
+};
@@ -0,0 +1,330 @@
+/*
+  ==============================================================================
+    Source/Core/OscBundler.h
+    Per-tick OSC coalescing (one UDP datagram per scheduler tick)
+  ==============================================================================
+*/
+#pragma once
+#include "TrafficCapture.h"
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <juce_osc/juce_osc.h>
+
+// OSC messages with float arguments encoded straight into a fixed buffer,
+// as the elements of a bundle (each behind its size prefix). No OSCMessage
+// and no allocation; add() refuses what doesn't fit.
+class OscPacket {
+public:
+  OscPacket() {
+    std::memcpy(data.data(), "#bundle", 8);
+    writeUint32(0); // time tag 1: immediately
+    writeUint32(1);
+  }
+
+  bool add(const juce::OSCAddressPattern &address,
+           std::initializer_list<float> args) {
+    const auto text = address.toString(); // shared, not copied
+    const auto *utf8 = text.toRawUTF8();
+    const int addressBytes = (int)std::strlen(utf8) + 1;
+    const int numArgs = (int)args.size();
+    const int messageBytes =
+        pad4(addressBytes) + pad4(numArgs + 2) + 4 * numArgs;
+    if (count == maxElements || numArgs > maxArgs ||
+        size + 4 + messageBytes > (int)data.size())
+      return false;
+
+    writeUint32((juce::uint32)messageBytes);
+    elementStarts[(size_t)count] = size;
+    writePadded(utf8, addressBytes);
+    char tags[maxArgs + 2] = {','};
+    for (int i = 0; i < numArgs; ++i)
+      tags[i + 1] = 'f';
+    writePadded(tags, numArgs + 2);
+    for (auto f : args) {
+      juce::uint32 bits;
+      std::memcpy(&bits, &f, 4);
+      writeUint32(bits);
+    }
+    ++count;
+    return true;
+  }
+
+  int getNumMessages() const { return count; }
+  // The whole bundle
+  const char *getData() const { return data.data(); }
+  int getSize() const { return size; }
+  // Message i on its own, without bundle header or size prefix
+  const char *getMessageData(int i) const {
+    return data.data() + elementStarts[(size_t)i];
+  }
+  int getMessageSize(int i) const {
+    return (int)juce::ByteOrder::bigEndianInt(data.data() +
+                                              elementStarts[(size_t)i] - 4);
+  }
+
+  static constexpr int maxElements = 8, maxArgs = 4;
+
+private:
+  static int pad4(int n) { return (n + 3) & ~3; }
+
+  void writeUint32(juce::uint32 v) {
+    v = juce::ByteOrder::swapIfLittleEndian(v);
+    std::memcpy(data.data() + size, &v, 4);
+    size += 4;
+  }
+
+  void writePadded(const char *bytes, int n) {
+    std::memcpy(data.data() + size, bytes, (size_t)n);
+    std::memset(data.data() + size + n, 0, (size_t)(pad4(n) - n));
+    size += pad4(n);
+  }
+
+  std::array<char, 512> data;
+  std::array<int, maxElements> elementStarts{};
+  int size = 8; // past "#bundle\0"; the constructor adds the time tag
+  int count = 0;
+};
+
+// Wraps the OSCSender used for all outgoing traffic. With bundling off every
+// message is its own datagram (the old behaviour). With bundling on, messages
+// queue into an OSCBundle that the scheduler flushes once per tick, so a
+// note-on (note + velocity) or a dense chord leaves as a single packet.
+class OscBundler {
+public:
+  explicit OscBundler(juce::OSCSender &s) : sender(s) {}
+
+  void setEnabled(bool shouldBundle) {
+    const juce::ScopedLock sl(lock);
+    flushLocked();
+    enabled = shouldBundle;
+  }
+  bool isEnabled() const { return enabled; }
+
+  // Upper bound for one datagram; a bundle that would grow past it is sent
+  // early and a new one started. Keep under the path MTU to avoid IP
+  // fragmentation over Wi-Fi.
+  void setMaxBundleBytes(int bytes) {
+    maxBundleBytes = juce::jlimit(64, 65000, bytes);
+  }
+  int getMaxBundleBytes() const { return maxBundleBytes; }
+
+  // Every message handed to send() is also recorded here while capturing
+  void setCapture(TrafficCapture *c) { capture = c; }
+
+  // When set, every message goes straight here instead of to the sender,
+  // unbundled (offline render). Set before anything is sent.
+  void setSink(std::function<void(const juce::OSCMessage &)> fn) {
+    const juce::ScopedLock sl(lock);
+    sink = std::move(fn);
+  }
+  bool hasSink() const { return sink != nullptr; }
+
+  // --- Direct path, for the MIDI input threads ---
+  // sendDirect() writes an OscPacket to a socket of its own: no OSCMessage,
+  // no allocation, and not `lock`, which the scheduler, receiver and
+  // playback threads share. Only directLock, which nothing else takes but
+  // a retarget, serialises the MIDI device and replay threads. With
+  // bundling on the packet leaves as one bundle right away instead of
+  // joining the tick's; with it off, one datagram per message as usual.
+  void setDirectTarget(const juce::String &host, int port) {
+    const juce::SpinLock::ScopedLockType sl(directLock);
+    directHost = host;
+    directPort = port;
+  }
+
+  // False while a sink is set or a capture runs (both want OSCMessages)
+  // or with no target: the caller then goes through send()
+  bool canSendDirect() const {
+    return directPort > 0 && !hasSink() &&
+           (capture == nullptr || !capture->isCapturing());
+  }
+
+  void sendDirect(const OscPacket &packet) {
+    const int n = packet.getNumMessages();
+    if (n == 0)
+      return;
+    const juce::SpinLock::ScopedLockType sl(directLock);
+    if (directPort <= 0)
+      return;
+    messagesSent += n;
+    if (enabled && n > 1) {
+      ++packetsSent;
+      directSocket.write(directHost, directPort, packet.getData(),
+                         packet.getSize());
+      return;
+    }
+    for (int i = 0; i < n; ++i) {
+      ++packetsSent;
+      directSocket.write(directHost, directPort, packet.getMessageData(i),
+                         packet.getMessageSize(i));
+    }
+  }
+
+  template <typename... Args>
+  bool send(const juce::OSCAddressPattern &address, Args &&...args) {
+    return send(juce::OSCMessage(address, std::forward<Args>(args)...));
+  }
+
+  bool send(const juce::OSCMessage &m) {
+    if (capture != nullptr)
+      capture->recordOsc(m, CaptureRecord::OscOut);
+    const juce::ScopedLock sl(lock);
+    ++messagesSent;
+    if (sink) {
+      sink(m);
+      return true;
+    }
+    if (inTimedGroup) {
+      timedGroup.addElement(m);
+      timedGroupBytes += 4 + estimateMessageSize(m);
+      return true;
+    }
+    if (!enabled && burstDepth == 0) {
+      ++packetsSent;
+      return sender.send(m);
+    }
+    int size = 4 + estimateMessageSize(m); // element size prefix
+    if (pendingCount > 0 && pendingBytes + size > maxBundleBytes)
+      flushLocked();
+    pending.addElement(m);
+    pendingBytes += size;
+    ++pendingCount;
+    return true;
+  }
+
+  // Bypasses bundling: anything pending goes out first, then m on its own.
+  // For timing probes, which a tick's worth of queueing would skew.
+  bool sendNow(const juce::OSCMessage &m) {
+    if (capture != nullptr)
+      capture->recordOsc(m, CaptureRecord::OscOut);
+    const juce::ScopedLock sl(lock);
+    flushLocked();
+    ++messagesSent;
+    if (sink) {
+      sink(m);
+      return true;
+    }
+    ++packetsSent;
+    return sender.send(m);
+  }
+
+  // Everything sent between begin/endTimedGroup is wrapped in one bundle
+  // stamped with `when`, so the receiver can execute it at that time rather
+  // than on arrival. The lock is held for the whole group; other threads'
+  // sends wait and never end up inside it. With bundling on, the group is
+  // nested in the pending tick bundle.
+  void beginTimedGroup(juce::OSCTimeTag when) {
+    lock.enter();
+    jassert(!inTimedGroup);
+    timedGroup = juce::OSCBundle(when);
+    timedGroupBytes = 16;
+    inTimedGroup = true;
+  }
+
+  void endTimedGroup() {
+    jassert(inTimedGroup);
+    inTimedGroup = false;
+    if (timedGroup.size() > 0) {
+      if (!enabled) {
+        ++packetsSent;
+        sender.send(timedGroup);
+      } else {
+        int size = 4 + timedGroupBytes;
+        if (pendingCount > 0 && pendingBytes + size > maxBundleBytes)
+          flushLocked();
+        pending.addElement(timedGroup);
+        pendingBytes += size;
+        ++pendingCount;
+      }
+    }
+    timedGroup = juce::OSCBundle();
+    lock.exit();
+  }
+
+  // Sends between begin/endBurst are bundled even with bundling off, up to
+  // the max bundle size per datagram, and leave at endBurst rather than on
+  // the next tick. Other threads' sends wait for the burst to finish.
+  void beginBurst() {
+    lock.enter();
+    ++burstDepth;
+  }
+
+  void endBurst() {
+    jassert(burstDepth > 0);
+    if (--burstDepth == 0)
+      flushLocked();
+    lock.exit();
+  }
+
+  // Called at the end of every scheduler tick
+  void flush() {
+    const juce::ScopedLock sl(lock);
+    flushLocked();
+  }
+
+  juce::int64 getMessagesSent() const { return messagesSent; }
+  juce::int64 getPacketsSent() const { return packetsSent; }
+  juce::int64 getPacketsSaved() const { return messagesSent - packetsSent; }
+  void resetCounters() {
+    messagesSent = 0;
+    packetsSent = 0;
+  }
+
+  // Encoded OSC size: padded address, padded type tags, arguments
+  static int estimateMessageSize(const juce::OSCMessage &m) {
+    auto pad4 = [](int n) { return (n + 3) & ~3; };
+    int size = pad4(m.getAddressPattern().toString().getNumBytesAsUTF8() + 1);
+    size += pad4(m.size() + 2); // ',' + tags + '\0'
+    for (auto &arg : m) {
+      if (arg.isString())
+        size += pad4((int)arg.getString().getNumBytesAsUTF8() + 1);
+      else if (arg.isBlob())
+        size += 4 + pad4((int)arg.getBlob().getSize());
+      else
+        size += 4;
+    }
+    return size;
+  }
+
+private:
+  void flushLocked() {
+    if (pendingCount == 0)
+      return;
+    ++packetsSent;
+    if (pendingCount == 1 && pending[0].isMessage())
+      sender.send(pending[0].getMessage()); // no bundle header for a single
+    else {
+      pending.setTimeTag(juce::OSCTimeTag(juce::Time::getCurrentTime()));
+      sender.send(pending);
+    }
+    pending = juce::OSCBundle();
+    pendingBytes = 16; // "#bundle\0" + time tag
+    pendingCount = 0;
+  }
+
+  juce::OSCSender &sender;
+  TrafficCapture *capture = nullptr;
+  std::function<void(const juce::OSCMessage &)> sink; // under lock
+  juce::CriticalSection lock;
+  std::atomic<bool> enabled{false};
+  std::atomic<int> maxBundleBytes{1400};
+
+  juce::OSCBundle pending;
+  int pendingBytes = 16;
+  int pendingCount = 0;
+
+  juce::DatagramSocket directSocket{false};
+  juce::String directHost; // under directLock
+  std::atomic<int> directPort{0};
+  juce::SpinLock directLock;
+
+  juce::OSCBundle timedGroup;
+  int timedGroupBytes = 16;
+  bool inTimedGroup = false; // only ever true while `lock` is held
+  int burstDepth = 0;         // same
+
+  std::atomic<juce::int64> messagesSent{0}, packetsSent{0};
+};
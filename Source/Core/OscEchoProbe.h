@@ -0,0 +1,128 @@
+/*
+  ==============================================================================
+    Source/Core/OscEchoProbe.h
+    OSC ping/pong round-trip measurement to the configured OSC target
+  ==============================================================================
+*/
+#pragma once
+#include "LatencyHistogram.h"
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <juce_osc/juce_osc.h>
+
+// Sends "/pwb/ping <int seq>" to the OSC target at a fixed rate and times
+// the matching "/pwb/pong <int seq>" coming back on the receive port. The
+// far end needs a responder: another bridge with "Answer pings" on, or a
+// patch that echoes the sequence number. Jitter is the RFC 3550 running
+// estimate (mean deviation of consecutive RTTs); a ping counts as lost when
+// its slot is reused without a pong having arrived.
+class OscEchoProbe : private juce::Thread {
+public:
+  static constexpr const char *pingAddress = "/pwb/ping";
+  static constexpr const char *pongAddress = "/pwb/pong";
+  static constexpr int historySize = 64; // pings in flight we can match
+
+  OscEchoProbe() : juce::Thread("OscEchoProbe") {}
+  ~OscEchoProbe() override { stop(); }
+
+  // Probe thread. Sends one ping; should bypass any bundling.
+  std::function<void(const juce::OSCMessage &)> sendPing;
+
+  // Message thread. intervalMs <= 0 stops probing.
+  void start(int intervalMs) {
+    interval = intervalMs;
+    if (intervalMs <= 0) {
+      stop();
+      return;
+    }
+    if (!isThreadRunning()) {
+      reset();
+      startThread();
+    }
+    notify(); // pick up the new interval now
+  }
+
+  void stop() { stopThread(1000); }
+  bool isRunning() const { return isThreadRunning(); }
+
+  // OSC receiver thread
+  void handlePong(int seq) {
+    auto &slot = history[(size_t)(seq & (historySize - 1))];
+    auto sentAt = slot.sentMicros.load(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq || sentAt == 0 ||
+        !slot.sentMicros.compare_exchange_strong(sentAt, 0))
+      return; // too old, or a duplicate
+    auto rtt = LatencyHistogram::nowMicros() - sentAt;
+    rttHistogram.record(rtt);
+    ++received;
+
+    auto prev = lastRtt.exchange(rtt);
+    if (prev >= 0) {
+      auto d = (double)std::abs(rtt - prev);
+      jitter = jitter + (d - jitter) / 16.0;
+    }
+  }
+
+  void reset() {
+    for (auto &slot : history) {
+      slot.seq = -1;
+      slot.sentMicros = 0;
+    }
+    rttHistogram.reset();
+    lastRtt = -1;
+    jitter = 0.0;
+    lost = 0;
+    received = 0;
+  }
+
+  // "RTT 3.21ms (p99 5.02, jitter 0.41, loss 0%)" or "RTT --"
+  juce::String getStatusString() const {
+    auto rtt = lastRtt.load();
+    if (rtt < 0)
+      return isRunning() ? "RTT --" : "RTT off";
+    auto snap = rttHistogram.getSnapshot();
+    auto answered = received.load(), unanswered = lost.load();
+    auto lossPct = 100.0 * (double)unanswered /
+                   (double)juce::jmax<juce::int64>(1, answered + unanswered);
+    return "RTT " + juce::String(rtt / 1000.0, 2) + "ms (p99 " +
+           juce::String(snap.p99 / 1000.0, 2) + ", jitter " +
+           juce::String(jitter.load() / 1000.0, 2) + ", loss " +
+           juce::String(lossPct, 0) + "%)";
+  }
+
+  juce::int64 getLastRttMicros() const { return lastRtt; }
+  double getJitterMicros() const { return jitter; }
+  LatencyHistogram::Snapshot getRttSnapshot() const {
+    return rttHistogram.getSnapshot();
+  }
+
+private:
+  void run() override {
+    int seq = 0;
+    while (!threadShouldExit()) {
+      if (sendPing) {
+        auto &slot = history[(size_t)(seq & (historySize - 1))];
+        slot.seq.store(seq, std::memory_order_relaxed);
+        if (slot.sentMicros.exchange(LatencyHistogram::nowMicros(),
+                                     std::memory_order_acq_rel) != 0)
+          ++lost; // never answered in historySize intervals
+        sendPing(juce::OSCMessage(juce::OSCAddressPattern(pingAddress),
+                                  (juce::int32)seq));
+        seq = (seq + 1) & 0x7fffffff;
+      }
+      wait(juce::jmax(10, interval.load()));
+    }
+  }
+
+  struct Slot {
+    std::atomic<int> seq{-1};
+    std::atomic<juce::int64> sentMicros{0};
+  };
+  std::array<Slot, historySize> history;
+  LatencyHistogram rttHistogram;
+  std::atomic<int> interval{1000};
+  std::atomic<juce::int64> lastRtt{-1}, lost{0}, received{0};
+  std::atomic<double> jitter{0.0};
+};
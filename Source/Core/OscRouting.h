@@ -0,0 +1,153 @@
+/*
+  ==============================================================================
+    Source/Core/OscRouting.h
+    Compiled OSC address tables (RX dispatch, TX address cache)
+  ==============================================================================
+*/
+#pragma once
+#include "OscEchoProbe.h"
+#include <array>
+#include <juce_osc/juce_osc.h>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+// OSC address templates, "{X}" standing for the channel. The defaults are
+// the ones the OSC Config page starts with.
+struct OscAddresses {
+  // Received
+  juce::String play = "/play", stop = "/stop", tap = "/tap", panic = "/panic";
+  juce::String vol1 = "/ch1/vol", vol2 = "/ch2/vol";
+  juce::String noteOn = "/ch{X}n", noteOff = "/ch{X}noff",
+               pitchWheel = "/ch{X}wheel";
+
+  // Sent, in OscAddressCache::Type order
+  juce::StringArray tx{"/ch{X}note",     "/ch{X}nvalue",   "/ch{X}noteoff",
+                       "/ch{X}cc",       "/ch{X}ccvalue",  "/ch{X}pitch",
+                       "/ch{X}pressure", "/ch{X}pressure"};
+};
+
+// --- RX DISPATCH ---
+// Every configured RX address is expanded once ("{X}" -> 1..16) into an
+// exact address -> (action, channel) map, so the receive path resolves a
+// packet with a single hash lookup instead of rebuilding pattern strings.
+struct OscRoute {
+  enum class Action {
+    None,
+    Play,
+    Stop,
+    Tap,
+    Panic,
+    Vol1,
+    Vol2,
+    NoteOn,
+    NoteOff,
+    PitchWheel,
+    ProbePing, // OscEchoProbe
+    ProbePong
+  };
+  Action action = Action::None;
+  int channel = 0;
+};
+
+class OscDispatchTable {
+public:
+  // The full RX table for a set of templates, probe addresses included
+  static std::shared_ptr<const OscDispatchTable>
+  build(const OscAddresses &addr) {
+    // Same priority order the handler used to test addresses in
+    using A = OscRoute::Action;
+    auto table = std::make_shared<OscDispatchTable>();
+    table->addExact(addr.play, A::Play);
+    table->addExact(addr.stop, A::Stop);
+    table->addExact(addr.tap, A::Tap);
+    table->addExact(addr.panic, A::Panic);
+    table->addExact(addr.vol1, A::Vol1);
+    table->addExact(addr.vol2, A::Vol2);
+    table->addPerChannel(addr.noteOn, A::NoteOn);
+    table->addPerChannel(addr.noteOff, A::NoteOff);
+    table->addPerChannel(addr.pitchWheel, A::PitchWheel);
+    table->addExact(OscEchoProbe::pingAddress, A::ProbePing);
+    table->addExact(OscEchoProbe::pongAddress, A::ProbePong);
+    return table;
+  }
+
+  void clear() { routes.clear(); }
+
+  // Fixed address (transport/GUI controls). First entry for an address wins,
+  // so add in the same priority order the handler used to test them.
+  void addExact(const juce::String &address, OscRoute::Action action) {
+    if (address.isNotEmpty())
+      routes.emplace(address, OscRoute{action, 0});
+  }
+
+  // Per-channel pattern. A pattern without "{X}" resolves to channel 1, the
+  // same as the old per-message matcher did.
+  void addPerChannel(const juce::String &pattern, OscRoute::Action action) {
+    if (pattern.isEmpty())
+      return;
+    for (int ch = 1; ch <= 16; ++ch)
+      routes.emplace(pattern.replace("{X}", juce::String(ch)),
+                     OscRoute{action, ch});
+  }
+
+  OscRoute find(const juce::String &address) const {
+    auto it = routes.find(address);
+    return it != routes.end() ? it->second : OscRoute{};
+  }
+
+  int size() const { return (int)routes.size(); }
+
+private:
+  struct StringHash {
+    size_t operator()(const juce::String &s) const noexcept { return s.hash(); }
+  };
+  std::unordered_map<juce::String, OscRoute, StringHash> routes;
+};
+
+// --- TX ADDRESS CACHE ---
+// Ready-made address patterns per (channel, message type), with "{X}"
+// already replaced by the mixer's channel name. Rebuilt when the TX config
+// or the channel names change; the send path only indexes into it.
+class OscAddressCache {
+public:
+  enum Type {
+    NoteOn,
+    NoteVelocity,
+    NoteOff,
+    CC,
+    CCValue,
+    PitchBend,
+    Pressure,
+    PolyAftertouch,
+    NumTypes
+  };
+
+  // templates: one per Type. channelNames: 16 entries, index = channel - 1.
+  OscAddressCache(const juce::StringArray &templates,
+                  const juce::StringArray &channelNames) {
+    for (int ch = 0; ch < 16; ++ch)
+      for (int t = 0; t < NumTypes; ++t) {
+        auto addr = templates[t].replace("{X}", channelNames[ch]);
+        if (addr.isEmpty())
+          continue;
+        try {
+          patterns[(size_t)ch][(size_t)t].emplace(addr);
+        } catch (const juce::OSCFormatError &) {
+          // Leave the slot empty; an invalid address is skipped on send
+        }
+      }
+  }
+
+  // nullptr when the channel is out of range or the address is unusable
+  const juce::OSCAddressPattern *get(int channel, Type t) const {
+    if (channel < 1 || channel > 16)
+      return nullptr;
+    auto &slot = patterns[(size_t)(channel - 1)][(size_t)t];
+    return slot.has_value() ? &*slot : nullptr;
+  }
+
+private:
+  std::array<std::array<std::optional<juce::OSCAddressPattern>, NumTypes>, 16>
+      patterns;
+};
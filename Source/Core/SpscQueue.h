@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+    Source/Core/SpscQueue.h
+    Fixed-capacity single-producer / single-consumer queue
+  ==============================================================================
+*/
+#pragma once
+#include <array>
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+// Wait-free handoff of small POD items between exactly one producer thread
+// and one consumer thread (juce::AbstractFifo index bookkeeping over a
+// preallocated array). push/pop never lock or allocate; push fails when full.
+template <typename T, int Capacity> class SpscQueue {
+public:
+  bool push(const T &item) {
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 == 0) {
+      ++dropped;
+      return false;
+    }
+    items[(size_t)(size1 > 0 ? start1 : start2)] = item;
+    fifo.finishedWrite(1);
+    return true;
+  }
+
+  bool pop(T &item) {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(1, start1, size1, start2, size2);
+    if (size1 + size2 == 0)
+      return false;
+    item = items[(size_t)(size1 > 0 ? start1 : start2)];
+    fifo.finishedRead(1);
+    return true;
+  }
+
+  int getNumReady() const { return fifo.getNumReady(); }
+  int getDropped() const { return dropped; }
+
+private:
+  // AbstractFifo keeps one slot free to tell full from empty
+  juce::AbstractFifo fifo{Capacity + 1};
+  std::array<T, (size_t)Capacity + 1> items{};
+  std::atomic<int> dropped{0};
+};
+
+// Bytes of a channel voice message, trivially copyable so it can sit in an
+// SpscQueue between the network/device threads and the MIDI output thread.
+struct RawMidi {
+  juce::uint8 bytes[3] = {0, 0, 0};
+  juce::uint8 numBytes = 0;
+
+  static RawMidi from(const juce::MidiMessage &m) {
+    RawMidi r;
+    r.numBytes = (juce::uint8)juce::jmin(3, m.getRawDataSize());
+    for (int i = 0; i < r.numBytes; ++i)
+      r.bytes[i] = m.getRawData()[i];
+    return r;
+  }
+
+  juce::MidiMessage toMessage() const {
+    return juce::MidiMessage(bytes, (int)numBytes);
+  }
+};
@@ -0,0 +1,280 @@
+/*
+  ==============================================================================
+    Source/Core/TrafficCapture.h
+    Full-rate OSC/MIDI traffic capture to disk, and timed replay
+  ==============================================================================
+*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_osc/juce_osc.h>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// One captured OSC message or MIDI event, 64 bytes on disk. OSC arguments
+// are kept as floats (the only type the bridge sends or reads); strings and
+// blobs are not captured. Native byte order.
+struct CaptureRecord {
+  enum Type : juce::uint8 { OscIn, OscOut, MidiIn, MidiOut };
+  static constexpr int maxArgs = 3;
+  static constexpr int maxAddressBytes = 36;
+
+  juce::int64 timeMicros = 0; // getMillisecondCounterHiRes() * 1000
+  Type type = OscIn;
+  juce::uint8 numArgs = 0, addressLength = 0, midiSize = 0;
+  juce::uint8 midi[4] = {};
+  float args[maxArgs] = {};
+  char address[maxAddressBytes] = {};
+
+  bool isOsc() const { return type == OscIn || type == OscOut; }
+  bool isInput() const { return type == OscIn || type == MidiIn; }
+
+  juce::OSCMessage toOscMessage() const {
+    juce::OSCMessage m(juce::OSCAddressPattern(
+        juce::String::fromUTF8(address, (int)addressLength)));
+    for (int i = 0; i < numArgs; ++i)
+      m.addFloat32(args[i]);
+    return m;
+  }
+
+  juce::MidiMessage toMidiMessage() const {
+    return juce::MidiMessage(midi, (int)midiSize);
+  }
+};
+static_assert(std::is_trivially_copyable<CaptureRecord>::value &&
+                  sizeof(CaptureRecord) == 64,
+              "CaptureRecord is the on-disk format");
+
+// Streams CaptureRecords to a file. Any thread records by copying 64 bytes
+// into the front buffer under a SpinLock; the writer thread swaps the two
+// buffers (a pointer swap under the same lock) and writes the back one
+// while producers keep filling the front, so the scheduler and network
+// threads never wait on the disk. If the writer falls a whole buffer
+// behind, records are dropped and counted.
+class TrafficCapture : private juce::Thread {
+public:
+  static constexpr int bufferRecords = 16384; // 1 MB per buffer
+  static constexpr char magic[8] = {'P', 'W', 'B', 'C', 'A', 'P', '0', '1'};
+
+  TrafficCapture() : juce::Thread("TrafficCapture") {
+    front.reserve((size_t)bufferRecords);
+    back.reserve((size_t)bufferRecords);
+  }
+  ~TrafficCapture() override { stop(); }
+
+  // Message thread. False if the file can't be written.
+  bool start(const juce::File &file) {
+    stop();
+    file.getParentDirectory().createDirectory();
+    auto out = std::make_unique<juce::FileOutputStream>(file);
+    if (!out->openedOk())
+      return false;
+    out->setPosition(0);
+    out->truncate();
+    out->write(magic, sizeof(magic));
+    out->writeInt((int)sizeof(CaptureRecord));
+
+    {
+      const juce::SpinLock::ScopedLockType sl(bufferLock);
+      front.clear();
+      back.clear();
+    }
+    stream = std::move(out);
+    currentFile = file;
+    written = 0;
+    dropped = 0;
+    capturing = true;
+    startThread();
+    return true;
+  }
+
+  // Message thread. Writes whatever is still buffered and closes the file.
+  void stop() {
+    if (!capturing)
+      return;
+    capturing = false;
+    stopThread(2000);
+    writeOut(); // front buffer leftovers
+    stream.reset();
+  }
+
+  bool isCapturing() const { return capturing; }
+  juce::File getFile() const { return currentFile; }
+  juce::int64 getRecordsWritten() const { return written; }
+  juce::int64 getRecordsDropped() const { return dropped; }
+
+  // --- Any thread ---
+  void recordOsc(const juce::OSCMessage &m, CaptureRecord::Type type) {
+    if (!capturing)
+      return;
+    CaptureRecord r;
+    r.timeMicros = nowMicros();
+    r.type = type;
+    auto address = m.getAddressPattern().toString();
+    auto bytes = juce::jmin((int)address.getNumBytesAsUTF8(),
+                            CaptureRecord::maxAddressBytes);
+    std::memcpy(r.address, address.toRawUTF8(), (size_t)bytes);
+    r.addressLength = (juce::uint8)bytes;
+    for (auto &arg : m) {
+      if (r.numArgs == CaptureRecord::maxArgs)
+        break;
+      if (arg.isFloat32())
+        r.args[r.numArgs++] = arg.getFloat32();
+      else if (arg.isInt32())
+        r.args[r.numArgs++] = (float)arg.getInt32();
+    }
+    push(r);
+  }
+
+  // timeMs: when the event hits the wire, if not now (timed MIDI blocks)
+  void recordMidi(const juce::MidiMessage &m, CaptureRecord::Type type,
+                  double timeMs = -1.0) {
+    if (!capturing)
+      return;
+    CaptureRecord r;
+    r.timeMicros =
+        timeMs >= 0.0 ? (juce::int64)(timeMs * 1000.0) : nowMicros();
+    r.type = type;
+    r.midiSize = (juce::uint8)juce::jmin(3, m.getRawDataSize());
+    std::memcpy(r.midi, m.getRawData(), r.midiSize);
+    push(r);
+  }
+
+  static juce::int64 nowMicros() {
+    return (juce::int64)(juce::Time::getMillisecondCounterHiRes() * 1000.0);
+  }
+
+  // Hands every record of a capture to fn(const CaptureRecord &), in file
+  // order, reading 1 MB at a time so a capture of any size streams through.
+  // Stops at the last complete record actually read: a truncated or
+  // damaged tail is dropped, never replayed as zeros. False if the file is
+  // missing or not a capture.
+  template <typename Fn>
+  static bool readRecords(const juce::File &file, Fn &&fn) {
+    juce::FileInputStream in(file);
+    char header[sizeof(magic)];
+    if (!in.openedOk() || in.read(header, sizeof(header)) != sizeof(header) ||
+        std::memcmp(header, magic, sizeof(magic)) != 0 ||
+        in.readInt() != (int)sizeof(CaptureRecord))
+      return false;
+    std::vector<CaptureRecord> chunk((size_t)bufferRecords);
+    for (;;) {
+      auto bytes = in.read(chunk.data(),
+                           (int)(chunk.size() * sizeof(CaptureRecord)));
+      auto complete = bytes > 0 ? (size_t)bytes / sizeof(CaptureRecord) : 0;
+      for (size_t i = 0; i < complete; ++i)
+        fn(static_cast<const CaptureRecord &>(chunk[i]));
+      if (complete < chunk.size())
+        return true;
+    }
+  }
+
+private:
+  void push(const CaptureRecord &r) {
+    bool wake;
+    {
+      const juce::SpinLock::ScopedLockType sl(bufferLock);
+      if ((int)front.size() >= bufferRecords) {
+        ++dropped;
+        return;
+      }
+      front.push_back(r);
+      wake = (int)front.size() == bufferRecords / 2;
+    }
+    if (wake)
+      notify();
+  }
+
+  void run() override {
+    while (!threadShouldExit()) {
+      wait(50);
+      writeOut();
+    }
+  }
+
+  // Writer thread (or the message thread once the writer has stopped)
+  void writeOut() {
+    {
+      const juce::SpinLock::ScopedLockType sl(bufferLock);
+      std::swap(front, back);
+    }
+    if (back.empty())
+      return;
+    stream->write(back.data(), back.size() * sizeof(CaptureRecord));
+    written += (juce::int64)back.size();
+    back.clear(); // keeps capacity
+  }
+
+  juce::SpinLock bufferLock;
+  std::vector<CaptureRecord> front, back;
+  std::unique_ptr<juce::FileOutputStream> stream;
+  juce::File currentFile;
+  std::atomic<bool> capturing{false};
+  std::atomic<juce::int64> written{0}, dropped{0};
+};
+
+// Plays a capture's input records (OSC in, MIDI in) back at their original
+// spacing on its own thread. Outputs are skipped: the bridge regenerates
+// them from the replayed inputs.
+class CaptureReplayer : private juce::Thread {
+public:
+  CaptureReplayer() : juce::Thread("CaptureReplay") {}
+  ~CaptureReplayer() override { stop(); }
+
+  // Replay thread
+  std::function<void(const CaptureRecord &)> onRecord;
+  std::function<void()> onFinished;
+
+  // Message thread. Returns the number of input records queued for replay.
+  int start(const juce::File &file) {
+    stop();
+    records.clear();
+    TrafficCapture::readRecords(file, [this](const CaptureRecord &r) {
+      if (r.isInput())
+        records.push_back(r);
+    });
+    // Threads append in lock order, which can trail their timestamps
+    std::stable_sort(records.begin(), records.end(),
+                     [](const CaptureRecord &a, const CaptureRecord &b) {
+                       return a.timeMicros < b.timeMicros;
+                     });
+    if (!records.empty())
+      startThread(juce::Thread::Priority::high);
+    return (int)records.size();
+  }
+
+  void stop() { stopThread(2000); }
+  bool isReplaying() const { return isThreadRunning(); }
+
+private:
+  void run() override {
+    const double startMs = juce::Time::getMillisecondCounterHiRes();
+    const auto firstMicros = records.front().timeMicros;
+    for (auto &r : records) {
+      const double dueMs =
+          startMs + (double)(r.timeMicros - firstMicros) / 1000.0;
+      // Sleep most of the gap, spin the last couple of milliseconds
+      for (;;) {
+        if (threadShouldExit())
+          return;
+        double remaining = dueMs - juce::Time::getMillisecondCounterHiRes();
+        if (remaining <= 0.0)
+          break;
+        if (remaining > 2.0)
+          wait((int)remaining - 1);
+        else
+          juce::Thread::yield();
+      }
+      if (onRecord)
+        onRecord(r);
+    }
+    if (onFinished)
+      onFinished();
+  }
+
+  std::vector<CaptureRecord> records; // inputs only, in capture order
+};
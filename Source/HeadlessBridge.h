@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+    Source/HeadlessBridge.h
+    Windowless bridge: the engine configured once from a BridgeConfig
+  ==============================================================================
+*/
+#pragma once
+#include "Core/BridgeConfig.h"
+#include "Core/BridgeEngine.h"
+#include "Core/LogRing.h"
+#include "Core/OfflineRender.h"
+#include <JuceHeader.h>
+#include <atomic>
+#include <csignal>
+#include <iostream>
+
+// Runs BridgeEngine with no components at all: nothing is painted and no
+// keyboard echoes or traffic records are produced unless --verbose asks
+// for them. Status lines go to stdout from a 4 Hz timer, which also turns
+// Ctrl+C / SIGTERM into a normal JUCE quit.
+class HeadlessBridge : private juce::Timer {
+public:
+  explicit HeadlessBridge(const BridgeConfig &c) : config(c) {
+    engine.setKeyboardEchoes(false);
+    engine.setTrafficLogging(config.verbose);
+    // Engine threads only push; printing happens on the message thread
+    engine.onLog = [this](const LogEvent &e) { lines.push(e); };
+  }
+
+  ~HeadlessBridge() override {
+    stopTimer();
+    engine.shutdown();
+    printLines();
+  }
+
+  // False if a port or device named in the config could not be opened
+  bool start() {
+    std::signal(SIGINT, requestQuit);
+    std::signal(SIGTERM, requestQuit);
+
+    // Config first: start() then leaves Link off for --no-link
+    engine.applyConfig(config);
+    engine.start();
+
+    bool ok = openMidi(config.midiIn, true) && openMidi(config.midiOut, false);
+    // connectOsc logs which port failed
+    if (ok && config.connectOsc &&
+        !engine.connectOsc(config.ip, config.sendPort, config.receivePort))
+      ok = false;
+    if (ok && config.captureFile != juce::File())
+      ok = engine.startCapture(config.captureFile);
+    if (ok && config.midiFile != juce::File()) {
+      engine.loadFile(config.midiFile);
+      engine.togglePlay();
+    }
+
+    printLines();
+    if (!ok)
+      return false;
+    startTimerHz(4);
+    return true;
+  }
+
+  // --render: plays --file through OfflineRender into the render file and
+  // prints the throughput. --render-check renders it a second time and
+  // fails unless both outputs match byte for byte. Returns the process
+  // exit code.
+  static int render(const BridgeConfig &config) {
+    auto file = LoadedMidiFile::parse(config.midiFile);
+    if (file == nullptr) {
+      std::cerr << "! Could not read "
+                << config.midiFile.getFullPathName() << "\n";
+      return 1;
+    }
+    juce::FileOutputStream out(config.renderFile);
+    if (!out.openedOk()) {
+      std::cerr << "! Cannot write " << config.renderFile.getFullPathName()
+                << "\n";
+      return 1;
+    }
+    out.setPosition(0);
+    out.truncate();
+
+    auto name = file->file.getFileName();
+    auto r = OfflineRender(config).render(file, out);
+    const double wallMs = juce::jmax(0.001, r.wallMs);
+    std::cout << "Rendered " << name << ": " << r.oscMessages << " OSC, "
+              << r.midiEvents << " MIDI in "
+              << juce::String(r.renderedMs / 1000.0, 1) << " s of playback, "
+              << juce::String(wallMs, 1) << " ms wall ("
+              << juce::String(r.renderedMs / wallMs, 0) << "x realtime, "
+              << juce::String((r.oscMessages + r.midiEvents) / wallMs * 1000.0,
+                              0)
+              << " events/s)" << std::endl;
+
+    if (config.renderCheck) {
+      juce::MemoryOutputStream again;
+      OfflineRender(config).render(std::move(file), again);
+      juce::MemoryBlock written;
+      if (!config.renderFile.loadFileAsData(written) ||
+          written != again.getMemoryBlock()) {
+        std::cerr << "! Render check failed: a second render of " << name
+                  << " differs" << std::endl;
+        return 1;
+      }
+      std::cout << "Render check: second render identical ("
+                << (juce::int64)written.getSize() << " bytes)" << std::endl;
+    }
+    return 0;
+  }
+
+private:
+  static void requestQuit(int) { quitRequested = true; }
+
+  bool openMidi(const juce::String &name, bool isInput) {
+    if (name.isEmpty())
+      return true;
+    auto id = BridgeEngine::findMidiDevice(
+        isInput ? juce::MidiInput::getAvailableDevices()
+                : juce::MidiOutput::getAvailableDevices(),
+        name);
+    if (id.isNotEmpty() &&
+        (isInput ? engine.openMidiInput(id) : engine.openMidiOutput(id))) {
+      engine.log(juce::String(isInput ? "MIDI In: " : "MIDI Out: ") + name);
+      return true;
+    }
+    engine.log("! No MIDI " + juce::String(isInput ? "input" : "output") +
+               " matching " + name);
+    return false;
+  }
+
+  void timerCallback() override {
+    if (quitRequested) {
+      stopTimer();
+      juce::JUCEApplicationBase::quit();
+      return;
+    }
+
+    // Without --bpm, follow the tempo of the file that just went live
+    auto playing = engine.getPlayingFile();
+    if (playing != shownFile) {
+      shownFile = playing;
+      if (shownFile != nullptr && shownFile->fileBpm > 0.0 &&
+          config.bpm <= 0.0)
+        engine.setTempo(shownFile->fileBpm);
+      if (shownFile != nullptr && shownFile->file != juce::File())
+        engine.log("Loaded: " + shownFile->file.getFileName());
+    }
+
+    if (config.statsSeconds > 0 && ++statsTicks >= config.statsSeconds * 4) {
+      statsTicks = 0;
+      std::cout << engine.getStatsString()
+                << " | Log Dropped: " << lines.getDropped() << std::endl;
+    }
+    printLines();
+  }
+
+  void printLines() {
+    lines.drain([this](const LogEvent &e) {
+      juce::String line;
+      if (e.kind != LogEvent::Text)
+        std::cout << e.toExportString() << "\n";
+      else if (textJoiner.add(e, line))
+        std::cout << line << "\n";
+    });
+    std::cout.flush();
+  }
+
+  inline static std::atomic<bool> quitRequested{false};
+
+  BridgeConfig config;
+  LogRing<LogEvent, 4096> lines; // before engine, whose threads push to it
+  LogTextJoiner textJoiner;
+  BridgeEngine engine;
+  std::shared_ptr<const LoadedMidiFile> shownFile;
+  int statsTicks = 0;
+};
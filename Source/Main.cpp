@@ -4,8 +4,10 @@
     Updated: Clean Start
   ==============================================================================
 */
+#include "HeadlessBridge.h"
 #include "MainComponent.h"
 #include <JuceHeader.h>
+#include <iostream>
 #include <memory>
 
 class StandaloneOSCApplication : public juce::JUCEApplication {
@@ -18,10 +20,38 @@ public:
   bool moreThanOneInstanceAllowed() override { return true; }
 
   void initialise(const juce::String &) override {
+    auto args = getCommandLineParameterArray();
+    if (args.contains("--headless") || args.contains("--help")) {
+      BridgeConfig config;
+      auto error = config.parse(args);
+      if (error.isNotEmpty() || args.contains("--help")) {
+        if (error.isNotEmpty())
+          std::cerr << error << "\n\n" << BridgeConfig::getUsage();
+        else
+          std::cout << BridgeConfig::getUsage();
+        setApplicationReturnValue(error.isNotEmpty() ? 2 : 0);
+        quit();
+        return;
+      }
+      if (config.renderFile != juce::File()) {
+        setApplicationReturnValue(HeadlessBridge::render(config));
+        quit();
+        return;
+      }
+      headless = std::make_unique<HeadlessBridge>(config);
+      if (!headless->start()) {
+        setApplicationReturnValue(1);
+        quit();
+      }
+      return;
+    }
     mainWindow.reset(new MainWindow(getApplicationName()));
   }
 
-  void shutdown() override { mainWindow = nullptr; }
+  void shutdown() override {
+    mainWindow = nullptr;
+    headless = nullptr;
+  }
 
   class MainWindow : public juce::DocumentWindow {
   public:
@@ -54,6 +84,7 @@ public:
 
 private:
   std::unique_ptr<MainWindow> mainWindow;
+  std::unique_ptr<HeadlessBridge> headless;
 };
 
 START_JUCE_APPLICATION(StandaloneOSCApplication)
\ No newline at end of file
@@ -7,7 +7,6 @@
 
 #include "MainComponent.h"
 #include <JuceHeader.h>
-#include <ableton/Link.hpp>
 #include <algorithm>
 #include <cmath>
 #include <map>
@@ -16,13 +15,9 @@
 // DESTRUCTOR
 //==============================================================================
 MainComponent::~MainComponent() {
-  if (link != nullptr) {
-    link->enable(false);
-    delete link;
-    link = nullptr;
-  }
+  shutdownAudio(); // the audio callback drives the engine in audio clock mode
+  engine.shutdown();
   juce::Timer::stopTimer();
-  juce::HighResolutionTimer::stopTimer();
   openGLContext.detach();
   keyboardState.removeListener(this);
 }
@@ -40,13 +35,12 @@ MainComponent::MainComponent()
       trackGrid(keyboardState), logPanel(), playlist(), sequencer(), mixer(),
       oscConfig(), controlPage() {
 
-  // --- Ableton Link Init ---
-  link = new ableton::Link(120.0);
-  {
-    auto state = link->captureAppSessionState();
-    state.setTempo(bpmVal.get(), link->clock().micros());
-    link->commitAppSessionState(state);
-  }
+  // --- Engine ---
+  engine.setTempo(bpmVal.get());
+  // Status lines show even while the traffic log is paused
+  engine.onLog = [this](const LogEvent &e) {
+    logPanel.logEvent(e, e.kind == LogEvent::Text);
+  };
 
   // --- Logo ---
   if (BinaryData::logo_pngSize > 0) {
@@ -82,7 +76,6 @@ MainComponent::MainComponent()
   addAndMakeVisible(lblNoteDelay);
   lblNoteDelay.setText("Duration:", juce::dontSendNotification);
   lblNoteDelay.setJustificationType(juce::Justification::centredRight);
-  transportStartBeat = 0.0;
 
   // --- Group Headers ---
   grpNet.setText("Network Setup");
@@ -99,9 +92,7 @@ MainComponent::MainComponent()
     s.setRange(0, 127, 1);
     s.setValue(100);
     s.onValueChange = [this, &s, &t] {
-      if (isOscConnected) {
-        oscSender.send(t.getText(), (float)s.getValue() / 127.0f);
-      }
+      engine.sendOsc(t.getText(), (float)s.getValue() / 127.0f);
     };
     addAndMakeVisible(s);
 
@@ -116,6 +107,8 @@ MainComponent::MainComponent()
   setupSimpleVol(vol2Simple, txtVol2Osc, 2);
   txtVol1Osc.setText("/ch1/vol", juce::dontSendNotification);
   txtVol2Osc.setText("/ch2/vol", juce::dontSendNotification);
+  txtVol1Osc.onTextChange = [this] { pushOscAddresses(); };
+  txtVol2Osc.onTextChange = [this] { pushOscAddresses(); };
 
   addAndMakeVisible(btnVol1CC);
   btnVol1CC.setButtonText("CC20");
@@ -141,26 +134,15 @@ MainComponent::MainComponent()
   cmbQuantum.setSelectedId(3); // Default 4 Beats
   cmbQuantum.onChange = [this] {
     int sel = cmbQuantum.getSelectedId();
-    if (sel == 1)
-      quantum = 1.0;
-    else if (sel == 2)
-      quantum = 2.0;
-    else if (sel == 3)
-      quantum = 4.0;
-    else if (sel == 4)
-      quantum = 8.0;
-    else if (sel == 5)
-      quantum = 16.0;
+    if (sel >= 1 && sel <= 5)
+      engine.setQuantum((double)(1 << (sel - 1))); // 1, 2, 4, 8, 16 beats
   };
 
   addAndMakeVisible(btnLinkToggle);
   btnLinkToggle.setToggleState(true, juce::dontSendNotification);
   btnLinkToggle.onClick = [this] {
-    bool enabled = btnLinkToggle.getToggleState();
-    link->enable(enabled);
-    link->enableStartStopSync(enabled);
+    engine.setLinkEnabled(btnLinkToggle.getToggleState());
     startupRetryActive = false;
-    logPanel.log(enabled ? "Link Enabled" : "Link Disabled", true);
   };
 
   addAndMakeVisible(btnPreventBpmOverride);
@@ -170,6 +152,22 @@ MainComponent::MainComponent()
 
   addAndMakeVisible(btnBlockMidiOut);
   btnBlockMidiOut.setButtonText("Block Out");
+  btnBlockMidiOut.onClick = [this] {
+    engine.setBlockMidiOut(btnBlockMidiOut.getToggleState());
+  };
+
+  addAndMakeVisible(btnAudioClock);
+  btnAudioClock.setTooltip("Drive playback from the audio device clock and "
+                           "time-stamp outgoing MIDI/OSC events");
+  btnAudioClock.onClick = [this] {
+    bool on = btnAudioClock.getToggleState();
+    if (on && deviceManager.getCurrentAudioDevice() == nullptr) {
+      btnAudioClock.setToggleState(false, juce::dontSendNotification);
+      logPanel.log("! Audio Clock: no audio device open", true);
+      return;
+    }
+    engine.setAudioClockEnabled(on);
+  };
 
   // --- Nudge Slider ---
   addAndMakeVisible(nudgeSlider);
@@ -182,20 +180,9 @@ MainComponent::MainComponent()
   nudgeSlider.addListener(this);
 
   nudgeSlider.onValueChange = [this] {
-    if (link) {
-      double mult = 1.0 + nudgeSlider.getValue();
-      double target = baseBpm * mult;
-      auto state = link->captureAppSessionState();
-      state.setTempo(target, link->clock().micros());
-      link->commitAppSessionState(state);
-    }
-  };
-  nudgeSlider.onDragStart = [this] {
-    if (link) {
-      auto state = link->captureAppSessionState();
-      baseBpm = state.tempo();
-    }
+    engine.setTempo(baseBpm * (1.0 + nudgeSlider.getValue()));
   };
+  nudgeSlider.onDragStart = [this] { baseBpm = engine.getTempo(); };
 
   addAndMakeVisible(lblLatency);
   lblLatency.setText("Nudge", juce::dontSendNotification);
@@ -205,33 +192,7 @@ MainComponent::MainComponent()
   // --- Tap Tempo ---
   addAndMakeVisible(btnTapTempo);
   btnTapTempo.onClick = [this] {
-    double nowMs = juce::Time::getMillisecondCounterHiRes();
-    if (!tapTimes.empty() && (nowMs - tapTimes.back() > 2000.0)) {
-      tapTimes.clear();
-      tapCounter = 0;
-    }
-    tapTimes.push_back(nowMs);
-    tapCounter++;
-    if (tapCounter >= 4) {
-      double sumDiff = 0.0;
-      for (size_t i = 1; i < tapTimes.size(); ++i)
-        sumDiff += (tapTimes[i] - tapTimes[i - 1]);
-      double avgDiff = sumDiff / (double)(tapTimes.size() - 1);
-      if (avgDiff > 50.0) {
-        double bpm = 60000.0 / avgDiff;
-        bpm = juce::jlimit(20.0, 444.0, bpm);
-        auto state = link->captureAppSessionState();
-        state.setTempo(bpm, link->clock().micros());
-        link->commitAppSessionState(state);
-        parameters.setProperty("bpm", bpm, nullptr);
-        juce::MessageManager::callAsync([this, bpm] {
-          tempoSlider.setValue(bpm, juce::dontSendNotification);
-        });
-        logPanel.log("Tap Tempo: " + juce::String(bpm), true);
-      }
-      tapTimes.clear();
-      tapCounter = 0;
-    }
+    engine.tapTempo(); // the slider follows Link in timerCallback
     grabKeyboardFocus();
   };
 
@@ -239,7 +200,12 @@ MainComponent::MainComponent()
   addAndMakeVisible(btnPanic);
   btnPanic.setButtonText("PANIC");
   btnPanic.setColour(juce::TextButton::buttonColourId, juce::Colours::darkred);
-  btnPanic.onClick = [this] { sendPanic(); };
+  btnPanic.onClick = [this] { engine.panic(); };
+  engine.onPanic = [this] {
+    keyboardState.allNotesOff(getSelectedChannel());
+    verticalKeyboard.repaint();
+    horizontalKeyboard.repaint();
+  };
 
   addAndMakeVisible(btnDash);
   btnDash.onClick = [this] {
@@ -263,6 +229,10 @@ MainComponent::MainComponent()
   oscViewport.setVisible(false);
   oscViewport.setInterceptsMouseClicks(true, true);
   oscViewport.setAlwaysOnTop(true);
+  oscConfig.onAddressChanged = [this] { pushOscAddresses(); };
+  oscConfig.onBundleSettingsChanged = [this](bool bundle, int maxBytes) {
+    engine.setOscBundling(bundle, maxBytes);
+  };
 
   addChildComponent(controlPage);
   controlPage.setAlwaysOnTop(true);
@@ -286,8 +256,14 @@ MainComponent::MainComponent()
 
   addAndMakeVisible(btnRetrigger);
   btnRetrigger.setButtonText("Retrig");
+  btnRetrigger.onClick = [this] {
+    engine.setRetriggerEnabled(btnRetrigger.getToggleState());
+  };
 
   addAndMakeVisible(btnGPU);
+  // The piano roll draws its notes through this context when attached
+  openGLContext.setRenderer(&trackGrid.gpu);
+  openGLContext.setOpenGLVersionRequired(juce::OpenGLContext::openGL3_2);
   btnGPU.onClick = [this] {
     if (btnGPU.getToggleState())
       openGLContext.attachTo(*this);
@@ -320,24 +296,17 @@ MainComponent::MainComponent()
   btnConnect.setColour(juce::TextButton::buttonOnColourId, juce::Colours::red);
   btnConnect.onClick = [this] {
     if (btnConnect.getToggleState()) {
-      if (oscSender.connect(edIp.getText(), edPOut.getText().getIntValue())) {
-        oscReceiver.connect(edPIn.getText().getIntValue());
-        oscReceiver.addListener(this);
-        isOscConnected = true;
+      logPanel.resetStats();
+      if (engine.connectOsc(edIp.getText(), edPOut.getText().getIntValue(),
+                            edPIn.getText().getIntValue())) {
         ledConnect.isConnected = true;
         btnConnect.setButtonText("Disconnect");
-        logPanel.log("OSC Connected", true);
-        logPanel.resetStats();
       } else
         btnConnect.setToggleState(false, juce::dontSendNotification);
     } else {
-      oscSender.disconnect();
-      oscReceiver.disconnect();
-      isOscConnected = false;
+      engine.disconnectOsc();
       ledConnect.isConnected = false;
-      ledConnect.repaint();
       btnConnect.setButtonText("Connect");
-      logPanel.log("OSC Disconnected", true);
     }
     ledConnect.repaint();
     grabKeyboardFocus();
@@ -356,6 +325,9 @@ MainComponent::MainComponent()
   for (int i = 1; i <= 16; ++i)
     cmbMidiCh.addItem(juce::String(i), i);
   cmbMidiCh.setSelectedId(17, juce::dontSendNotification);
+  cmbMidiCh.onChange = [this] {
+    engine.setMidiChannel(cmbMidiCh.getSelectedId());
+  };
 
   addAndMakeVisible(tempoSlider);
   tempoSlider.setRange(20, 444, 1.0);
@@ -364,11 +336,7 @@ MainComponent::MainComponent()
   tempoSlider.onValueChange = [this] {
     double val = tempoSlider.getValue();
     parameters.setProperty("bpm", val, nullptr);
-    if (link) {
-      auto state = link->captureAppSessionState();
-      state.setTempo(val, link->clock().micros());
-      link->commitAppSessionState(state);
-    }
+    engine.setTempo(val);
   };
 
   cmbMidiIn.addItem("None", 1);
@@ -382,25 +350,21 @@ MainComponent::MainComponent()
   for (int i = 0; i < outputs.size(); ++i)
     cmbMidiOut.addItem(outputs[i].name, i + 2);
 
+  // "None" and "Virtual Keyboard" both leave the device port closed
   cmbMidiIn.onChange = [this] {
-    midiInput.reset();
-    if (cmbMidiIn.getSelectedId() > 2) {
-      midiInput = juce::MidiInput::openDevice(
-          juce::MidiInput::getAvailableDevices()[cmbMidiIn.getSelectedId() - 3]
-              .identifier,
-          this);
-      if (midiInput)
-        midiInput->start();
-    }
+    int index = cmbMidiIn.getSelectedId() - 3;
+    engine.openMidiInput(
+        index >= 0
+            ? juce::MidiInput::getAvailableDevices()[index].identifier
+            : juce::String());
     grabKeyboardFocus();
   };
   cmbMidiOut.onChange = [this] {
-    midiOutput.reset();
-    if (cmbMidiOut.getSelectedId() > 1)
-      midiOutput = juce::MidiOutput::openDevice(
-          juce::MidiOutput::getAvailableDevices()[cmbMidiOut.getSelectedId() -
-                                                  2]
-              .identifier);
+    int index = cmbMidiOut.getSelectedId() - 2;
+    engine.openMidiOutput(
+        index >= 0
+            ? juce::MidiOutput::getAvailableDevices()[index].identifier
+            : juce::String());
   };
 
   // --- Playback Controls ---
@@ -414,13 +378,8 @@ MainComponent::MainComponent()
   btnSkip.setButtonText(">");
 
   btnClearPR.onClick = [this] {
-    juce::ScopedLock sl(midiLock);
-    playbackSeq.clear();
-    sequenceLength = 0;
-    trackGrid.loadSequence(playbackSeq);
-    repaint();
+    engine.clearFile();
     logPanel.log("Piano Roll Cleared", true);
-    mixer.removeAllStrips(); // Reset Channels on Clear
     grabKeyboardFocus();
   };
 
@@ -431,9 +390,7 @@ MainComponent::MainComponent()
   btnResetBPM.setButtonText("Reset BPM");
   btnResetBPM.onClick = [this] {
     double target = (currentFileBpm > 0.0) ? currentFileBpm : 120.0;
-    auto state = link->captureAppSessionState();
-    state.setTempo(target, link->clock().micros());
-    link->commitAppSessionState(state);
+    engine.setTempo(target);
     parameters.setProperty("bpm", target, nullptr);
     tempoSlider.setValue(target, juce::dontSendNotification);
     grabKeyboardFocus();
@@ -448,7 +405,9 @@ MainComponent::MainComponent()
   btnSplit.setColour(juce::TextButton::buttonOnColourId,
                      juce::Colours::cyan.darker(0.3f));
   btnSplit.onClick = [this] {
-    if (btnSplit.getToggleState())
+    bool splitEnabled = btnSplit.getToggleState();
+    engine.setSplitEnabled(splitEnabled);
+    if (splitEnabled)
       logPanel.log("Split Mode: ON", true);
     else
       logPanel.log("Split Mode: OFF", true);
@@ -483,12 +442,10 @@ MainComponent::MainComponent()
         (int)(horizontal ? sliderModH.getValue() : sliderModV.getValue());
     auto mp = juce::MidiMessage::pitchWheel(ch, pVal);
     auto mm = juce::MidiMessage::controllerEvent(ch, 1, mVal);
-    if (midiOutput) {
-      midiOutput->sendMessageNow(mp);
-      midiOutput->sendMessageNow(mm);
-    }
-    sendSplitOscMessage(mp);
-    sendSplitOscMessage(mm);
+    engine.sendMidiNow(mp);
+    engine.sendMidiNow(mm);
+    engine.sendSplitOscMessage(mp);
+    engine.sendSplitOscMessage(mm);
     // Sync
     if (horizontal) {
       sliderPitchV.setValue(sliderPitchH.getValue(),
@@ -514,89 +471,71 @@ MainComponent::MainComponent()
   };
 
   // Octave Buttons
-  btnPrOctUp.onClick = [this] {
-    pianoRollOctaveShift++;
-    virtualOctaveShift = pianoRollOctaveShift;
-    logPanel.log("Octave + (" + juce::String(pianoRollOctaveShift) + ")", true);
-    grabKeyboardFocus();
-  };
-  btnPrOctDown.onClick = [this] {
-    pianoRollOctaveShift--;
-    virtualOctaveShift = pianoRollOctaveShift;
-    logPanel.log("Octave - (" + juce::String(pianoRollOctaveShift) + ")", true);
+  auto shiftOctave = [this](int delta) {
+    int octave = engine.getPlaybackOctaveShift() + delta;
+    engine.setPlaybackOctaveShift(octave);
+    engine.setOctaveShift(octave);
+    logPanel.log(juce::String(delta > 0 ? "Octave + (" : "Octave - (") +
+                     juce::String(octave) + ")",
+                 true);
     grabKeyboardFocus();
   };
+  btnPrOctUp.onClick = [shiftOctave] { shiftOctave(1); };
+  btnPrOctDown.onClick = [shiftOctave] { shiftOctave(-1); };
 
   // --- Transport Logic ---
   btnPlay.onClick = [this] {
-    if (isPlaying) {
-      // PAUSE
-      logPanel.log("Transport: Paused", true);
-      auto now = link->clock().micros();
-      auto session = link->captureAppSessionState();
-      beatsPlayedOnPause =
-          session.beatAtTime(now, quantum) - transportStartBeat;
-      session.setIsPlayingAndRequestBeatAtTime(false, now, 0.0, quantum);
-      isPlaying = false;
-      link->commitAppSessionState(session);
-      btnPlay.setButtonText("Play");
-      return;
-    }
-    // PLAY
-    auto now = link->clock().micros();
-    auto session = link->captureAppSessionState();
-    double currentBeat = session.beatAtTime(now, quantum);
-    transportStartBeat = currentBeat - beatsPlayedOnPause;
-    isPlaying = true;
-    btnPlay.setButtonText("Pause");
-    if (link->isEnabled()) {
-      logPanel.log("Transport: Waiting for Sync...", true);
-      pendingSyncStart = true;
-    } else {
-      logPanel.log("Transport: Playing (Internal)", true);
-      pendingSyncStart = false;
-      session.setIsPlayingAndRequestBeatAtTime(true, now, transportStartBeat,
-                                               quantum);
-      link->commitAppSessionState(session);
-      if (isOscConnected)
-        oscSender.send(oscConfig.ePlay.getText(), 1.0f);
-    }
+    engine.togglePlay();
+    updateTransportButton();
     grabKeyboardFocus();
   };
 
   btnStop.onClick = [this] {
-    if (!isPlaying && playbackCursor == 0)
-      return;
-    logPanel.log("Transport: Stopped", true);
-    auto now = link->clock().micros();
-    auto session = link->captureAppSessionState();
-    session.setIsPlayingAndRequestBeatAtTime(false, now, 0.0, quantum);
-    isPlaying = false;
-    btnPlay.setButtonText("Play");
-    stopPlayback();
-    link->commitAppSessionState(session);
-    if (isOscConnected)
-      oscSender.send(oscConfig.eStop.getText(), 1.0f);
+    engine.stop();
+    updateTransportButton();
     grabKeyboardFocus();
   };
 
+  // Keep playing: the new file takes over on the next bar
   btnPrev.onClick = [this] {
     logPanel.log("Track: Previous", true);
-    bool wasPlaying = isPlaying;
-    loadMidiFile(juce::File(playlist.getPrevFile()));
-    if (wasPlaying) {
-      isPlaying = true;
-      btnPlay.setButtonText("Pause");
-    }
+    loadMidiFile(juce::File(playlist.getPrevFile()), true);
   };
   btnSkip.onClick = [this] {
     logPanel.log("Track: Next", true);
-    bool wasPlaying = isPlaying;
-    loadMidiFile(juce::File(playlist.getNextFile()));
-    if (wasPlaying) {
-      isPlaying = true;
-      btnPlay.setButtonText("Pause");
+    loadMidiFile(juce::File(playlist.getNextFile()), true);
+  };
+
+  engine.onTrackFinished = [this] { btnSkip.onClick(); };
+
+  // --- Traffic capture / replay ---
+  logPanel.onCaptureChanged = [this](bool on) { setCaptureEnabled(on); };
+  logPanel.getLatencyJson = [this] { return engine.getLatencyJson(); };
+  logPanel.onReplay = [this] {
+    if (engine.isReplaying()) {
+      engine.stopReplay();
+      logPanel.log("Replay: stopped", true);
+      return;
     }
+    replayChooser = std::make_unique<juce::FileChooser>(
+        "Replay Capture",
+        juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+            .getChildFile("PatchworldBridge/Captures"),
+        "*.pwcap");
+    replayChooser->launchAsync(
+        juce::FileBrowserComponent::openMode |
+            juce::FileBrowserComponent::canSelectFiles,
+        [this](const juce::FileChooser &fc) {
+          if (fc.getResult() != juce::File())
+            engine.startReplay(fc.getResult());
+        });
+  };
+
+  // --- OSC round-trip probe ---
+  engine.setProbeSettings(oscConfig.eProbeMs.getText().getIntValue(),
+                          oscConfig.btnAnswerPings.getToggleState());
+  oscConfig.onProbeSettingsChanged = [this](int intervalMs, bool respond) {
+    engine.setProbeSettings(intervalMs, respond);
   };
 
   // --- Components Add ---
@@ -605,7 +544,10 @@ MainComponent::MainComponent()
   addAndMakeVisible(verticalKeyboard);
   addAndMakeVisible(logPanel);
   addAndMakeVisible(playlist);
+  playlist.onFilesChanged = [this] { requestPrefetch(); };
   playlist.onLoopModeChanged = [this](juce::String state) {
+    engine.setPlaylistMode((BridgeEngine::PlayMode)playlist.playMode);
+    requestPrefetch();
     logPanel.log("Playlist: " + state, true);
   };
   addAndMakeVisible(sequencer);
@@ -621,34 +563,41 @@ MainComponent::MainComponent()
   // --- Arpeggiator ---
   addAndMakeVisible(btnArp);
   btnArp.onClick = [this] {
-    if (!btnArp.getToggleState()) {
-      heldNotes.clear();
-      noteArrivalOrder.clear();
+    bool arpLatched = btnArp.getToggleState();
+    engine.setArpLatched(arpLatched);
+    if (!arpLatched) {
       keyboardState.allNotesOff(getSelectedChannel());
     } else {
-      heldNotes.clear();
-      noteArrivalOrder.clear();
-      for (int i = 0; i < 128; ++i) {
-        if (keyboardState.isNoteOn(1, i)) {
-          heldNotes.add(i);
-          noteArrivalOrder.push_back(i);
-        }
-      }
+      // Keys down when the latch goes on become the first arp notes
+      const int shift = engine.getOctaveShift() * 12;
+      for (int i = 0; i < 128; ++i)
+        if (keyboardState.isNoteOn(1, i))
+          engine.arpNoteOn(1, juce::jlimit(0, 127, i + shift));
     }
   };
   addAndMakeVisible(btnArpSync);
+  btnArpSync.onClick = [this] {
+    engine.setArpSync(btnArpSync.getToggleState());
+  };
   addAndMakeVisible(sliderArpSpeed);
   sliderArpSpeed.setSliderStyle(juce::Slider::RotaryVerticalDrag);
   sliderArpSpeed.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
   sliderArpSpeed.setRange(20, 1000, 1);
   sliderArpSpeed.setValue(400);
   sliderArpSpeed.setColour(juce::Slider::thumbColourId, Theme::accent);
+  // Step length in ms; with Sync on, the nearest beat division to it
+  sliderArpSpeed.onValueChange = [this] {
+    engine.setArpStepMs(sliderArpSpeed.getValue());
+  };
   addAndMakeVisible(sliderArpVel);
   sliderArpVel.setSliderStyle(juce::Slider::RotaryVerticalDrag);
   sliderArpVel.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
   sliderArpVel.setRange(0, 127, 1);
   sliderArpVel.setValue(90);
   sliderArpVel.setColour(juce::Slider::thumbColourId, Theme::accent);
+  sliderArpVel.onValueChange = [this] {
+    engine.setArpVelocity((int)sliderArpVel.getValue());
+  };
 
   lblArpBpm.setJustificationType(juce::Justification::centred);
   addAndMakeVisible(lblArpBpm);
@@ -663,22 +612,49 @@ MainComponent::MainComponent()
   cmbArpPattern.addItem("Play Order", 5);
   cmbArpPattern.addItem("Random", 6);
   cmbArpPattern.addItem("Diverge", 4);
+  cmbArpPattern.onChange = [this] {
+    switch (cmbArpPattern.getSelectedId()) {
+    case 2:
+      engine.setArpPattern(Arpeggiator::Down);
+      break;
+    case 3:
+      engine.setArpPattern(Arpeggiator::UpDown);
+      break;
+    case 4:
+      engine.setArpPattern(Arpeggiator::Diverge);
+      break;
+    case 5:
+      engine.setArpPattern(Arpeggiator::PlayOrder);
+      break;
+    case 6:
+      engine.setArpPattern(Arpeggiator::Random);
+      break;
+    case 7:
+      engine.setArpPattern(Arpeggiator::DownUp);
+      break;
+    default:
+      engine.setArpPattern(Arpeggiator::Up);
+      break;
+    }
+  };
   cmbArpPattern.setSelectedId(1);
 
   // --- Mixer Events ---
+  // Strip order and names only change here, so the engine's copy of the
+  // channel map is refreshed from these two callbacks
+  mixer.onChannelNamesChanged = [this] { pushChannelMap(); };
   mixer.onMixerActivity = [this](int ch, float val) {
-    sendSplitOscMessage(juce::MidiMessage::controllerEvent(ch, 7, (int)val));
+    engine.sendSplitOscMessage(
+        juce::MidiMessage::controllerEvent(ch, 7, (int)val));
     logPanel.log("Mixer Ch" + juce::String(ch) + ": " + juce::String((int)val),
                  false);
   };
   mixer.onChannelToggle = [this](int ch, bool active) {
     toggleChannel(ch, active);
+    pushChannelMap();
     logPanel.log("Ch" + juce::String(ch) + (active ? " ON" : " OFF"), false);
-    if (isOscConnected) {
-      juce::String addr =
-          oscConfig.eTXcc.getText().replace("{X}", juce::String(ch));
-      oscSender.send(addr, active ? 1.0f : 0.0f);
-    }
+    engine.sendOsc(oscConfig.eTXcc.getText().replace("{X}", juce::String(ch)),
+                   active ? 1.0f : 0.0f);
   };
 
   // --- Help ---
@@ -691,10 +667,19 @@ MainComponent::MainComponent()
 
   // --- Final Init ---
   setSize(800, 630);
-  link->enable(true);
-  link->enableStartStopSync(true);
+  pushOscAddresses();
+  pushChannelMap();
+  engine.onVolumeReceived = [this](int fader, float val) {
+    (fader == 1 ? vol1Simple : vol2Simple)
+        .setValue(val * 127.0f, juce::dontSendNotification);
+  };
+  // The piano roll repaints from these atomics on its own
+  engine.onPosition = [this](double beats, double playingTicksPerQuarter) {
+    trackGrid.playbackCursor = (float)(beats * playingTicksPerQuarter);
+    trackGrid.octaveShift = engine.getPlaybackOctaveShift();
+  };
+  engine.start();
   juce::Timer::startTimer(40);
-  juce::HighResolutionTimer::startTimer(1);
   currentView = AppView::Dashboard;
   updateVisibility();
   resized();
@@ -713,11 +698,11 @@ bool MainComponent::keyPressed(const juce::KeyPress &key, Component *) {
   if (cmbMidiIn.getSelectedId() != 2)
     return false;
   if (key.getKeyCode() == 'Z') {
-    virtualOctaveShift = juce::jmax(-2, virtualOctaveShift - 1);
+    engine.setOctaveShift(juce::jmax(-2, engine.getOctaveShift() - 1));
     return true;
   }
   if (key.getKeyCode() == 'X') {
-    virtualOctaveShift = juce::jmin(2, virtualOctaveShift + 1);
+    engine.setOctaveShift(juce::jmin(2, engine.getOctaveShift() + 1));
     return true;
   }
   static const std::map<int, int> keyToNote = {
@@ -726,7 +711,8 @@ bool MainComponent::keyPressed(const juce::KeyPress &key, Component *) {
       {'K', 72}, {'O', 73}, {'L', 74}, {'P', 75}, {';', 76}};
   auto it = keyToNote.find(key.getKeyCode());
   if (it != keyToNote.end()) {
-    int note = juce::jlimit(0, 127, it->second + (virtualOctaveShift * 12));
+    int note =
+        juce::jlimit(0, 127, it->second + (engine.getOctaveShift() * 12));
     keyboardState.noteOn(1, note, 1.0f);
     return true;
   }
@@ -742,358 +728,101 @@ void MainComponent::valueTreePropertyChanged(juce::ValueTree &tree,
   }
 }
 
-int MainComponent::matchOscChannel(const juce::String &pattern,
-                                   const juce::String &incoming) {
-  for (int i = 1; i <= 16; ++i)
-    if (incoming == pattern.replace("{X}", juce::String(i)))
-      return i;
-  return -1;
+// Address templates from the OSC Config page and the Simple mode faders
+void MainComponent::pushOscAddresses() {
+  OscAddresses a;
+  a.play = oscConfig.ePlay.getText();
+  a.stop = oscConfig.eStop.getText();
+  a.tap = oscConfig.eTap.getText();
+  a.panic = oscConfig.ePanic.getText();
+  a.vol1 = txtVol1Osc.getText();
+  a.vol2 = txtVol2Osc.getText();
+  a.noteOn = oscConfig.eRXn.getText();
+  a.noteOff = oscConfig.eRXnoff.getText();
+  a.pitchWheel = oscConfig.eRXwheel.getText();
+  // Order must match OscAddressCache::Type
+  a.tx = {oscConfig.eTXn.getText(),  oscConfig.eTXv.getText(),
+          oscConfig.eTXoff.getText(), oscConfig.eTXcc.getText(),
+          oscConfig.eTXccv.getText(), oscConfig.eTXp.getText(),
+          oscConfig.eTXpr.getText(),  oscConfig.eTXpoly.getText()};
+  engine.setOscAddresses(a);
 }
 
-void MainComponent::oscMessageReceived(const juce::OSCMessage &m) {
-  juce::String addr = m.getAddressPattern().toString();
-  float val = (m.size() > 0 && m[0].isFloat32()) ? m[0].getFloat32() : 0.0f;
-  float vel = (m.size() > 1 && m[1].isFloat32()) ? m[1].getFloat32() : 0.0f;
-  juce::String argVal = (m.size() > 0 && m[0].isFloat32())
-                            ? juce::String(m[0].getFloat32(), 2)
-                            : "";
-
-  juce::MessageManager::callAsync(
-      [this, addr, argVal] { logPanel.log(addr + " " + argVal, false); });
-
-  // Handle Playback Controls
-  if (addr == oscConfig.ePlay.getText()) {
-    juce::MessageManager::callAsync([this] { btnPlay.onClick(); });
-    return;
-  }
-  if (addr == oscConfig.eStop.getText()) {
-    juce::MessageManager::callAsync([this] { btnStop.onClick(); });
-    return;
-  }
-  if (addr == oscConfig.eTap.getText()) {
-    juce::MessageManager::callAsync([this] { btnTapTempo.triggerClick(); });
-    return;
-  }
-  if (addr == oscConfig.ePanic.getText()) {
-    juce::MessageManager::callAsync([this] { sendPanic(); });
-    return;
-  }
-
-  // Handle Simple Mode Faders (Vol1 / Vol2)
-  if (addr == txtVol1Osc.getText()) {
-    juce::MessageManager::callAsync([this, val] {
-      vol1Simple.setValue(val * 127.0f, juce::dontSendNotification);
-    });
-    return;
-  }
-  if (addr == txtVol2Osc.getText()) {
-    juce::MessageManager::callAsync([this, val] {
-      vol2Simple.setValue(val * 127.0f, juce::dontSendNotification);
-    });
-    return;
-  }
-
-  // --- STANDARD MIDI LOGIC ---
-  float scaledVal = (val <= 1.0f && val > 0.0f) ? val * 127.0f : val;
-  int scaledInt = (int)scaledVal;
-
-  // Handle Configurable Note On
-  int ch = matchOscChannel(oscConfig.eRXn.getText(), addr);
-  if (ch > 0) {
-    float velocity = (m.size() > 1) ? vel : 0.8f;
-    isHandlingOsc = true;
-    keyboardState.noteOn(ch, scaledInt, velocity);
-    isHandlingOsc = false;
-    if (midiOutput)
-      midiOutput->sendMessageNow(
-          juce::MidiMessage::noteOn(ch, scaledInt, velocity));
-    return;
-  }
-
-  // Handle Configurable Note Off
-  ch = matchOscChannel(oscConfig.eRXnoff.getText(), addr);
-  if (ch > 0) {
-    isHandlingOsc = true;
-    keyboardState.noteOff(ch, scaledInt, 0.0f);
-    isHandlingOsc = false;
-    if (midiOutput)
-      midiOutput->sendMessageNow(juce::MidiMessage::noteOff(ch, scaledInt));
-    return;
-  }
-
-  // Handle Configurable Pitch Wheel
-  ch = matchOscChannel(oscConfig.eRXwheel.getText(), addr);
-  if (ch > 0) {
-    if (midiOutput)
-      midiOutput->sendMessageNow(
-          juce::MidiMessage::pitchWheel(ch, (int)(val * 16383.0f)));
-    return;
-  }
-}
-
-void MainComponent::sendSplitOscMessage(const juce::MidiMessage &m,
-                                        int overrideChannel) {
-  if (!isOscConnected)
-    return;
-
-  auto sendTo = [this, &m](int rawCh) {
-    int ch = mixer.getMappedChannel(rawCh);
-    if (ch < 1 || ch > 16)
-      ch = 1;
-    juce::String customName = mixer.getChannelName(ch);
-
-    if (m.isNoteOn()) {
-      oscSender.send(oscConfig.eTXn.getText().replace("{X}", customName),
-                     (float)m.getNoteNumber());
-      oscSender.send(oscConfig.eTXv.getText().replace("{X}", customName),
-                     m.getVelocity() / 127.0f);
-    } else if (m.isNoteOff()) {
-      oscSender.send(oscConfig.eTXoff.getText().replace("{X}", customName),
-                     (float)m.getNoteNumber());
-    } else if (m.isController()) {
-      oscSender.send(oscConfig.eTXcc.getText().replace("{X}", customName),
-                     (float)m.getControllerNumber());
-      oscSender.send(oscConfig.eTXccv.getText().replace("{X}", customName),
-                     (float)m.getControllerValue() / 127.0f);
-    } else if (m.isPitchWheel()) {
-      oscSender.send(oscConfig.eTXp.getText().replace("{X}", customName),
-                     (float)m.getPitchWheelValue() / 16383.0f);
-    } else if (m.isAftertouch()) {
-      oscSender.send(oscConfig.eTXpoly.getText().replace("{X}", customName),
-                     (float)m.getNoteNumber(), m.getAfterTouchValue() / 127.0f);
-    }
-  };
-
-  int baseCh = (overrideChannel != -1)
-                   ? overrideChannel
-                   : (cmbMidiCh.getSelectedId() == 17
-                          ? (m.getChannel() > 0 ? m.getChannel() : 1)
-                          : cmbMidiCh.getSelectedId());
-
-  if (btnSplit.getToggleState() && baseCh == 1) {
-    if (m.isNoteOnOrOff()) {
-      int n = m.getNoteNumber();
-      sendTo(n < 64 ? 2 : 1);
-    } else {
-      sendTo(1);
-      sendTo(2);
-    }
-  } else {
-    sendTo(baseCh);
+// Mixer strip order, on/off state and names, for the engine's threads
+void MainComponent::pushChannelMap() {
+  std::array<int, 16> mapping;
+  juce::uint32 activeMask = 0;
+  juce::StringArray names;
+  for (int ch = 1; ch <= 16; ++ch) {
+    mapping[(size_t)ch - 1] = mixer.getMappedChannel(ch);
+    if (mixer.isChannelActive(ch))
+      activeMask |= 1u << (ch - 1);
+    names.add(mixer.getChannelName(ch));
   }
+  engine.setChannelMap(mapping, activeMask);
+  engine.setChannelNames(names);
 }
 
 void MainComponent::handleNoteOn(juce::MidiKeyboardState *, int ch, int note,
                                  float vel) {
+  if (isEchoingToKeyboard)
+    return; // display only, already routed
   if (vel == 0.0f) {
     handleNoteOff(nullptr, ch, note, 0.0f);
     return;
   }
-  int adj = juce::jlimit(0, 127, note + (virtualOctaveShift * 12));
-
-  if (btnSplit.getToggleState() && ch == 1) {
-    if (adj < 64)
-      ch = 2;
-  }
-
-  logPanel.log("Note On: " + juce::String(note), false);
-
   if (btnArp.getToggleState()) {
-    heldNotes.add(adj);
-    noteArrivalOrder.push_back(adj);
-  } else {
-    if (!isHandlingOsc)
-      sendSplitOscMessage(juce::MidiMessage::noteOn(ch, adj, vel));
-    if (midiOutput)
-      midiOutput->sendMessageNow(juce::MidiMessage::noteOn(ch, adj, vel));
+    int adj = juce::jlimit(0, 127, note + (engine.getOctaveShift() * 12));
+    logPanel.logEvent(LogEvent::make(LogEvent::NoteOn, LogEvent::In, ch, note,
+                                     juce::roundToInt(vel * 127.0f)));
+    engine.arpNoteOn(ch, adj);
+    return;
   }
+  engine.routeNoteOn(ch, note, vel);
 }
 
 void MainComponent::handleNoteOff(juce::MidiKeyboardState *, int ch, int note,
                                   float vel) {
-  int adj = juce::jlimit(0, 127, note + (virtualOctaveShift * 12));
+  if (isEchoingToKeyboard)
+    return; // display only, already routed
   if (btnArp.getToggleState())
-    return;
-
-  heldNotes.removeFirstMatchingValue(adj);
-
-  if (btnRetrigger.getToggleState()) {
-    juce::MidiMessage m = juce::MidiMessage::noteOn(ch, adj, 100.0f / 127.0f);
-    if (!isHandlingOsc)
-      sendSplitOscMessage(m);
-    if (midiOutput)
-      midiOutput->sendMessageNow(m);
-  } else {
-    juce::MidiMessage m = juce::MidiMessage::noteOff(ch, adj, vel);
-    if (!isHandlingOsc)
-      sendSplitOscMessage(m);
-    if (midiOutput)
-      midiOutput->sendMessageNow(m);
-  }
-}
-
-void MainComponent::hiResTimerCallback() {
-  double nowMs = juce::Time::getMillisecondCounterHiRes();
-  {
-    juce::ScopedLock sl(midiLock);
-    for (auto it = scheduledNotes.begin(); it != scheduledNotes.end();) {
-      if (nowMs >= it->releaseTimeMs) {
-        if (midiOutput)
-          midiOutput->sendMessageNow(
-              juce::MidiMessage::noteOff(it->channel, it->note));
-        keyboardState.noteOff(it->channel, it->note, 0.0f);
-        it = scheduledNotes.erase(it);
-      } else {
-        ++it;
-      }
-    }
-  }
-  for (auto it = activeVirtualNotes.begin(); it != activeVirtualNotes.end();) {
-    if (nowMs >= it->releaseTime) {
-      keyboardState.noteOff(it->channel, it->note, 0.0f);
-      it = activeVirtualNotes.erase(it);
-    } else {
-      ++it;
-    }
-  }
-
-  if (!link)
-    return;
-  auto session = link->captureAppSessionState();
-  auto now = link->clock().micros();
-  double quantum = 4.0;
-  double currentBeat = session.beatAtTime(now, quantum);
-
-  if (isPlaying) {
-    if (pendingSyncStart) {
-      if (session.phaseAtTime(now, quantum) < 0.05) {
-        transportStartBeat = currentBeat - beatsPlayedOnPause;
-        lastProcessedBeat = -1.0;
-        pendingSyncStart = false;
-        if (!session.isPlaying()) {
-          session.setIsPlayingAndRequestBeatAtTime(true, now, currentBeat,
-                                                   quantum);
-          link->commitAppSessionState(session);
-        }
-        if (isOscConnected)
-          oscSender.send(oscConfig.ePlay.getText(), 1.0f);
-      } else {
-        return;
-      }
-    }
-
-    double playbackBeats = currentBeat - transportStartBeat;
-    double rangeEnd = playbackBeats;
-
-    juce::ScopedLock sl(midiLock);
-    while (playbackCursor < playbackSeq.getNumEvents()) {
-      auto *ev = playbackSeq.getEventPointer(playbackCursor);
-      double eventBeat = ev->message.getTimeStamp() / ticksPerQuarterNote;
-      if (eventBeat >= rangeEnd)
-        break;
-
-      if (eventBeat >= lastProcessedBeat) {
-        int rawCh = ev->message.getChannel();
-        int ch = mixer.getMappedChannel(rawCh);
-
-        // APPLY OCTAVE SHIFT
-        int n = ev->message.getNoteNumber();
-        if (ev->message.isNoteOnOrOff()) {
-          n = juce::jlimit(0, 127, n + (pianoRollOctaveShift * 12));
-          auto mCopy = ev->message;
-          mCopy.setNoteNumber(n);
-
-          if (btnSplit.getToggleState() && ch == 1) {
-            if (n < 64)
-              ch = 2;
-          }
-
-          juce::String logMsg = mCopy.isNoteOn() ? "Note On" : "Note Off";
-          logPanel.log(logMsg + ": " + juce::String(n), false);
-
-          if (mixer.isChannelActive(ch)) {
-            sendSplitOscMessage(mCopy, ch);
-            if (midiOutput && !btnBlockMidiOut.getToggleState())
-              midiOutput->sendMessageNow(mCopy);
-          }
-        } else {
-          // CC / Pitch
-          if (mixer.isChannelActive(ch)) {
-            sendSplitOscMessage(ev->message, ch);
-            if (midiOutput && !btnBlockMidiOut.getToggleState())
-              midiOutput->sendMessageNow(ev->message);
-          }
-        }
-      }
-      playbackCursor++;
-    }
-    lastProcessedBeat = rangeEnd;
-    if (playbackCursor >= playbackSeq.getNumEvents() && sequenceLength > 0) {
-      if (playlist.playMode == MidiPlaylist::LoopOne) {
-        playbackCursor = 0;
-        lastProcessedBeat = -1.0;
-        transportStartBeat = std::floor(currentBeat / quantum) * quantum;
-        if (transportStartBeat < currentBeat)
-          transportStartBeat += quantum;
-      } else if (playlist.playMode == MidiPlaylist::LoopAll) {
-        isPlaying = false;
-        session.setIsPlayingAndRequestBeatAtTime(false, now, currentBeat,
-                                                 quantum);
-        juce::MessageManager::callAsync([this] { btnSkip.onClick(); });
-      } else {
-        isPlaying = false;
-        session.setIsPlayingAndRequestBeatAtTime(false, now, currentBeat,
-                                                 quantum);
-      }
-    }
-  }
-
-  // --- VISUAL UPDATES ---
-  {
-    double currentBeat = session.beatAtTime(now, quantum);
-    if (isPlaying) {
-      double playbackBeats = currentBeat - transportStartBeat;
-      trackGrid.playbackCursor =
-          (float)playbackBeats * (float)ticksPerQuarterNote;
-    } else {
-      trackGrid.playbackCursor =
-          (float)beatsPlayedOnPause * (float)ticksPerQuarterNote;
-    }
-    trackGrid.octaveShift = pianoRollOctaveShift;
-  }
+    return; // latched
+  engine.routeNoteOff(ch, note, vel);
 }
 
 void MainComponent::timerCallback() {
-  if (!link)
-    return;
-  auto session = link->captureAppSessionState();
-  double linkBpm = session.tempo();
+  drainKeyboardEchoes();
+  if (auto playing = engine.getPlayingFile(); playing != displayedFile)
+    showLoadedFile(std::move(playing));
+  double linkBpm = engine.getTempo();
   if (std::abs(bpmVal.get() - linkBpm) > 0.01) {
     parameters.setProperty("bpm", linkBpm, nullptr);
     tempoSlider.setValue(linkBpm, juce::dontSendNotification);
   }
+  updateTransportButton();
 
   static int statsCounter = 0;
   if (++statsCounter > 125) {
     statsCounter = 0;
-    logPanel.updateStats("Peers: " + juce::String(link->numPeers()));
+    logPanel.updateStats(engine.getStatsString());
   }
 
-  if (link && !link->isEnabled() && startupRetryActive) {
+  auto &link = engine.getLink();
+  if (!link.isEnabled() && startupRetryActive) {
     linkRetryCounter++;
     if (linkRetryCounter >= 125) {
       startupRetryActive = false;
     } else {
-      link->enable(true);
+      link.enable(true);
     }
   }
-  phaseVisualizer.setPhase(session.phaseAtTime(link->clock().micros(), quantum),
+  auto session = link.captureAppSessionState();
+  double quantum = engine.getQuantum();
+  phaseVisualizer.setPhase(session.phaseAtTime(link.clock().micros(), quantum),
                            quantum);
 }
 
-void MainComponent::loadMidiFile(juce::File f) {
-  mixer.removeAllStrips();
-
+void MainComponent::loadMidiFile(juce::File f, bool keepPlaying) {
   if (f.isDirectory()) {
     auto files = f.findChildFiles(juce::File::findFiles, false, "*.mid");
     for (auto &file : files)
@@ -1102,73 +831,53 @@ void MainComponent::loadMidiFile(juce::File f) {
   }
   if (!f.existsAsFile())
     return;
-  stopPlayback();
+  engine.loadFile(f, keepPlaying); // parsed off the message thread
+  updateTransportButton();
+}
 
-  juce::ScopedLock sl(midiLock);
-  juce::FileInputStream stream(f);
-  if (!stream.openedOk())
+// Brings the UI in line with the file playback has just switched to
+void MainComponent::showLoadedFile(
+    std::shared_ptr<const LoadedMidiFile> file) {
+  displayedFile = std::move(file); // releases the previous file here
+  if (displayedFile == nullptr)
     return;
 
-  juce::MidiFile mf;
-  if (mf.readFrom(stream)) {
-    ticksPerQuarterNote = (double)mf.getTimeFormat();
-    playbackSeq.clear();
-    sequencer.activeTracks.clear();
-    bool bpmFound = false;
-    for (int i = 0; i < mf.getNumTracks(); ++i) {
-      playbackSeq.addSequence(*mf.getTrack(i), 0);
-      if (i < 16)
-        mixer.strips[i]->setTrackName("Track " + juce::String(i + 1));
-
-      for (auto *ev : *mf.getTrack(i))
-        if (ev->message.isTempoMetaEvent() && !bpmFound) {
-          currentFileBpm = 60.0 / ev->message.getTempoSecondsPerQuarterNote();
-          if (link && !btnPreventBpmOverride.getToggleState()) {
-            auto sessionState = link->captureAppSessionState();
-            sessionState.setTempo(currentFileBpm, link->clock().micros());
-            link->commitAppSessionState(sessionState);
-            parameters.setProperty("bpm", currentFileBpm, nullptr);
-            double val = currentFileBpm;
-            juce::MessageManager::callAsync([this, val] {
-              tempoSlider.setValue(val, juce::dontSendNotification);
-            });
-          }
-          bpmFound = true;
-        }
+  ticksPerQuarterNote = displayedFile->ticksPerQuarterNote;
+  mixer.removeAllStrips();
+  for (int i = 0; i < juce::jmin(16, displayedFile->numTracks); ++i)
+    mixer.strips[i]->setTrackName("Track " + juce::String(i + 1));
+
+  if (displayedFile->fileBpm > 0.0) {
+    currentFileBpm = displayedFile->fileBpm;
+    if (!btnPreventBpmOverride.getToggleState()) {
+      engine.setTempo(currentFileBpm);
+      parameters.setProperty("bpm", currentFileBpm, nullptr);
+      tempoSlider.setValue(currentFileBpm, juce::dontSendNotification);
     }
-    playbackSeq.updateMatchedPairs();
-    sequenceLength = playbackSeq.getEndTime();
-    trackGrid.loadSequence(playbackSeq);
-    trackGrid.setTicksPerQuarter(ticksPerQuarterNote);
-    logPanel.log("Loaded: " + f.getFileName(), true);
+  }
+
+  playlist.setCurrentFile(displayedFile->file.getFullPathName());
+  requestPrefetch();
+
+  trackGrid.loadFile(displayedFile);
+  trackGrid.setTicksPerQuarter(ticksPerQuarterNote);
+  repaint();
+  if (displayedFile->file != juce::File()) {
+    logPanel.log("Loaded: " + displayedFile->file.getFileName(), true);
     grabKeyboardFocus();
   }
 }
 
-void MainComponent::sendPanic() {
-  logPanel.log("!!! PANIC !!!", true);
-  for (int ch = 1; ch <= 16; ++ch) {
-    juce::String channelName = mixer.getChannelName(ch);
-    for (int note = 0; note < 128; ++note) {
-      oscSender.send(oscConfig.eTXoff.getText().replace("{X}", channelName),
-                     (float)note, 0.0f);
-      if (midiOutput)
-        midiOutput->sendMessageNow(juce::MidiMessage::noteOff(ch, note));
-    }
-    if (midiOutput) {
-      midiOutput->sendMessageNow(juce::MidiMessage::allNotesOff(ch));
-      midiOutput->sendMessageNow(juce::MidiMessage::allSoundOff(ch));
-    }
-  }
-  keyboardState.allNotesOff(getSelectedChannel());
-  heldNotes.clear();
-  noteArrivalOrder.clear();
-  activeVirtualNotes.clear();
-  scheduledNotes.clear();
-  juce::MessageManager::callAsync([this] {
-    verticalKeyboard.repaint();
-    horizontalKeyboard.repaint();
-  });
+// Keeps the engine holding the playlist entry after the one playing, parsed
+// and compiled, so Loop All can switch tracks without touching the disk
+void MainComponent::requestPrefetch() {
+  engine.prefetch(playlist.playMode == MidiPlaylist::LoopAll
+                      ? playlist.peekNextFile()
+                      : juce::String());
+}
+
+void MainComponent::updateTransportButton() {
+  btnPlay.setButtonText(engine.isPlaying() ? "Pause" : "Play");
 }
 
 void MainComponent::setView(AppView v) {
@@ -1214,6 +923,7 @@ void MainComponent::updateVisibility() {
   btnArp.setVisible(isDash && !isSimple);
   btnArpSync.setVisible(isDash && !isSimple);
   btnBlockMidiOut.setVisible(isDash && !isSimple);
+  btnAudioClock.setVisible(isDash && !isSimple);
   phaseVisualizer.setVisible(isDash && !isSimple);
   lblLatency.setVisible(isDash && !isSimple);
 
@@ -1442,6 +1152,7 @@ void MainComponent::resized() {
 
     auto lRow2 = rLink.removeFromTop(30);
     lblLatency.setBounds(lRow2.removeFromLeft(50));
+    btnAudioClock.setBounds(lRow2.removeFromRight(75));
     nudgeSlider.setBounds(lRow2);
 
     btnTapTempo.setBounds(rLink.removeFromTop(30).reduced(10, 0));
@@ -1456,15 +1167,27 @@ void MainComponent::resized() {
   }
 }
 
-void MainComponent::handleIncomingMidiMessage(juce::MidiInput *,
-                                              const juce::MidiMessage &m) {
-  juce::MessageManager::callAsync([this, m] {
-    if (m.isNoteOnOrOff())
-      keyboardState.processNextMidiEvent(m);
+// Message thread. Captures go to Documents/PatchworldBridge/Captures.
+void MainComponent::setCaptureEnabled(bool shouldCapture) {
+  if (!shouldCapture)
+    engine.stopCapture();
+  else if (!engine.startCapture(BridgeEngine::getDefaultCaptureFile()))
+    logPanel.btnCapture.setToggleState(false, juce::dontSendNotification);
+}
+
+// Mirrors notes that were already routed off the message thread onto the
+// on-screen keyboards, without feeding them back through handleNoteOn.
+void MainComponent::drainKeyboardEchoes() {
+  isEchoingToKeyboard = true;
+  engine.drainKeyboardEchoes([this](const BridgeEngine::KeyboardEcho &e) {
+    if (e.velocity > 0.0f)
+      keyboardState.noteOn(e.channel, e.note, e.velocity);
     else
-      sendSplitOscMessage(m);
+      keyboardState.noteOff(e.channel, e.note, 0.0f);
   });
+  isEchoingToKeyboard = false;
 }
+
 void MainComponent::toggleChannel(int ch, bool active) {
   if (active)
     activeChannels.insert(ch);
@@ -1474,24 +1197,24 @@ void MainComponent::toggleChannel(int ch, bool active) {
 int MainComponent::getSelectedChannel() const {
   return activeChannels.empty() ? 1 : *activeChannels.begin();
 }
-void MainComponent::stopPlayback() {
-  juce::ScopedLock sl(midiLock);
-  isPlaying = false;
-  playbackCursor = 0;
-  beatsPlayedOnPause = 0.0;
-  trackGrid.playbackCursor = 0.0;
-  lastProcessedBeat = -1.0;
-}
 void MainComponent::takeSnapshot() {}
 void MainComponent::performUndo() { undoManager.undo(); }
 void MainComponent::performRedo() { undoManager.redo(); }
-void MainComponent::paint(juce::Graphics &g) { g.fillAll(Theme::bgDark); }
+void MainComponent::paint(juce::Graphics &g) {
+  // Leave the GPU-drawn piano roll notes visible underneath
+  if (trackGrid.isVisible() && trackGrid.gpu.isDrawing())
+    g.excludeClipRegion(trackGrid.getBounds());
+  g.fillAll(Theme::bgDark);
+}
 void MainComponent::prepareToPlay(int, double sampleRate) {
-  currentSampleRate = sampleRate;
+  auto *device = deviceManager.getCurrentAudioDevice();
+  engine.prepareAudio(sampleRate,
+                      device ? device->getOutputLatencyInSamples() : 0);
 }
 void MainComponent::getNextAudioBlock(
     const juce::AudioSourceChannelInfo &bufferToFill) {
   bufferToFill.clearActiveBufferRegion();
+  engine.processAudioBlock(bufferToFill.numSamples);
 }
 void MainComponent::releaseResources() {}
 juce::String MainComponent::getLocalIPAddress() {
@@ -1508,11 +1231,7 @@ juce::String MainComponent::getLocalIPAddress() {
 void MainComponent::sliderDragEnded(juce::Slider *s) {
   if (s == &nudgeSlider) {
     s->setValue(0.0);
-    if (link) {
-      auto state = link->captureAppSessionState();
-      state.setTempo(baseBpm, link->clock().micros());
-      link->commitAppSessionState(state);
-    }
+    engine.setTempo(baseBpm);
   }
 }
 
@@ -5,20 +5,16 @@
   ==============================================================================
 */
 #pragma once
+#include "Core/BridgeEngine.h"
 #include "SubComponents.h"
 #include <JuceHeader.h>
-#include <ableton/Link.hpp>
 
 class MainComponent : public juce::AudioAppComponent,
                       public juce::FileDragAndDropTarget,
-                      public juce::MidiInputCallback,
                       public juce::MidiKeyboardState::Listener,
-                      public juce::OSCReceiver::Listener<
-                          juce::OSCReceiver::MessageLoopCallback>,
                       public juce::KeyListener,
                       public juce::ValueTree::Listener,
                       public juce::Timer,
-                      public juce::HighResolutionTimer,
                       public juce::Slider::Listener {
 public:
   MainComponent();
@@ -44,8 +40,6 @@ public:
   juce::String getLocalIPAddress();
 
 private:
-  ableton::Link *link;
-  double quantum = 4.0;
   juce::UndoManager undoManager;
   juce::ValueTree parameters{"Params"};
   juce::CachedValue<double> bpmVal;
@@ -79,6 +73,7 @@ private:
   juce::ToggleButton btnLinkToggle{"Link"}, btnArp{"Latch"}, btnArpSync{"Sync"};
   juce::ToggleButton btnPreventBpmOverride{"Lock BPM"};
   juce::ToggleButton btnBlockMidiOut{"Block Out"};
+  juce::ToggleButton btnAudioClock{"Audio Clk"};
   juce::TextButton btnSplit{"Split"};
 
   ConnectionLight ledConnect;
@@ -100,40 +95,22 @@ private:
   juce::Viewport oscViewport;
   ControlPage controlPage;
 
-  // Logic
-  std::unique_ptr<juce::MidiInput> midiInput;
-  std::unique_ptr<juce::MidiOutput> midiOutput;
-  juce::OSCSender oscSender;
-  juce::OSCReceiver oscReceiver;
-  bool isOscConnected = false;
-  juce::MidiMessageSequence playbackSeq;
-  double sequenceLength = 0, currentFileBpm = 0;
-  int playbackCursor = 0;
-  bool isPlaying = false;
-  juce::CriticalSection midiLock;
-
-  // Arp State
-  juce::Array<int> heldNotes;
-  std::vector<int> noteArrivalOrder;
-  int arpNoteIndex = 0;
-
-  int lastNumPeers = -1, virtualOctaveShift = 0, tapCounter = 0,
-      stepSeqIndex = -1,
-      pianoRollOctaveShift = 0; // Fixed: pianoRollOctaveShift declared here
-  std::vector<double> tapTimes;
+  // Replay file picker; the replay itself runs in the engine
+  std::unique_ptr<juce::FileChooser> replayChooser;
+
+  // Loaded file as last shown by the UI (message thread only)
+  std::shared_ptr<const LoadedMidiFile> displayedFile;
+  double currentFileBpm = 0;
+
+  int lastNumPeers = -1, stepSeqIndex = -1;
   std::set<int> activeChannels;
   juce::OpenGLContext openGLContext;
 
-  double lastProcessedBeat = -1.0;
-  double transportStartBeat = 0.0;
-  double beatsPlayedOnPause = 0.0;
-  double ticksPerQuarterNote = 960.0;
-  double currentSampleRate = 44100.0;
-  bool pendingSyncStart = false;
+  double ticksPerQuarterNote = 960.0; // displayedFile's, message thread
 
   int linkRetryCounter = 0;
   bool startupRetryActive = true;
-  bool isHandlingOsc = false;
+  bool isEchoingToKeyboard = false; // display-only keyboardState updates
 
   // --- SIMPLE MODE SPECIFIC VARIABLES (Fixes Undeclared Identifier Error) ---
   juce::Slider vol1Simple, vol2Simple;
@@ -143,45 +120,32 @@ private:
 
   double baseBpm = 120.0;
 
-  struct ActiveNote {
-    int channel;
-    int note;
-    double releaseTime;
-  };
-  std::vector<ActiveNote> activeVirtualNotes;
-
-  struct ScheduledNote {
-    int channel;
-    int note;
-    double releaseTimeMs;
-  };
-  std::vector<ScheduledNote> scheduledNotes;
+  // OSC, MIDI, Link and playback. Declared after every component so it is
+  // destroyed (and its threads stopped) before anything its callbacks use.
+  BridgeEngine engine;
 
   double getDurationFromVelocity(float velocity0to1);
 
   void updateVisibility();
   void setView(AppView v);
-  void sendPanic();
-  void loadMidiFile(juce::File f);
-  void stopPlayback();
+  void loadMidiFile(juce::File f, bool keepPlaying = false);
+  void showLoadedFile(std::shared_ptr<const LoadedMidiFile> file);
+  void requestPrefetch();
+  void updateTransportButton();
   void takeSnapshot();
-  void sendSplitOscMessage(const juce::MidiMessage &m,
-                           int overrideChannel = -1);
-  int matchOscChannel(const juce::String &pattern,
-                      const juce::String &incoming);
+  void pushOscAddresses();
+  void pushChannelMap();
+  void setCaptureEnabled(bool shouldCapture);
+  void drainKeyboardEchoes();
   int getSelectedChannel() const;
   void toggleChannel(int ch, bool active);
   void performUndo();
   void performRedo();
 
-  void handleIncomingMidiMessage(juce::MidiInput *,
-                                 const juce::MidiMessage &) override;
   void handleNoteOn(juce::MidiKeyboardState *, int, int, float) override;
   void handleNoteOff(juce::MidiKeyboardState *, int, int, float) override;
   void valueTreePropertyChanged(juce::ValueTree &,
                                 const juce::Identifier &) override;
-  void oscMessageReceived(const juce::OSCMessage &) override;
   void timerCallback() override;
-  void hiResTimerCallback() override;
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
\ No newline at end of file
@@ -8,9 +8,11 @@
 #include "Components/Common.h"
 #include "Components/Controls.h"
 #include "Components/Mixer.h"
+#include "Components/PianoRollRenderer.h"
 #include "Components/Sequencer.h"
 #include "Components/Tools.h"
 #include <JuceHeader.h>
+#include <array>
 
 // --- PIANO ROLL RATIOS ---
 static const float NoteWidthRatios[12] = {
@@ -35,23 +37,32 @@ public:
 };
 
 // --- PIANO ROLL COMPONENT ---
+// Drawn from two cached layers: the grid/header (rebuilt on resize only) and
+// the falling notes, which scroll by blitting the existing image down and
+// drawing just the newly exposed strip at the top. Nothing is repainted
+// while the cursor stands still. With the parent's OpenGL context attached,
+// `gpu` draws the notes instead and the notes area here stays transparent.
 class ComplexPianoRoll : public juce::Component, public juce::Timer {
 public:
   juce::MidiKeyboardState &keyboardState;
-  juce::MidiMessageSequence *sequence = nullptr;
+  const NoteIndex *notes = nullptr;
   float zoomX = 10.0f;
   float noteHeight = 12.0f;
-  float playbackCursor = 0.0f;
+  std::atomic<float> playbackCursor{0.0f}; // ticks, set by the scheduler
   double ticksPerQuarter = 960.0;
-  int octaveShift = 0;
+  std::atomic<int> octaveShift{0};
   int wheelStripWidth = 0;
+  PianoRollRenderer gpu{playbackCursor, octaveShift};
 
   ComplexPianoRoll(juce::MidiKeyboardState &state) : keyboardState(state) {
     startTimer(16); // ~60fps for smoother visuals
   }
 
-  void loadSequence(juce::MidiMessageSequence &seq) {
-    sequence = &seq;
+  void loadFile(std::shared_ptr<const LoadedMidiFile> file) {
+    notes = file ? &file->notes : nullptr;
+    gpu.setNotes(file);
+    loadedFile = std::move(file);
+    notesLayerValid = false;
     repaint();
   }
 
@@ -61,11 +72,72 @@ public:
   }
 
   void paint(juce::Graphics &g) override {
-    g.fillAll(Theme::bgDark);
+    const float currentTick = playbackCursor;
+    paintedWithGpu = gpu.isDrawing();
+    updateStaticLayer();
+    if (!paintedWithGpu)
+      updateNotesLayer(currentTick);
+    paintedCursor = currentTick;
+    paintedOctave = octaveShift;
+    if (!staticLayer.isValid())
+      return;
 
-    auto r = getLocalBounds();
+    g.drawImageAt(staticLayer, 0, 0);
+    if (!paintedWithGpu && notesLayer.isValid())
+      g.drawImageAt(notesLayer, 0, headerHeight);
+
+    // Progress marker on timeline
+    if (notes && notes->getEndTick() > 0) {
+      double progress = currentTick / notes->getEndTick();
+      float markerX = (float)progress * getWidth();
+      g.setColour(juce::Colours::red);
+      g.fillRect(markerX - 2, 0.0f, 4.0f, (float)headerHeight);
+    }
+  }
+
+  void resized() override {
+    staticLayer = {};
+    notesLayer = {};
+    notesLayerValid = false;
+    rebuildNoteX((float)(getWidth() - wheelStripWidth));
+  }
+  void moved() override { pushGpuLayout(); }
+  void visibilityChanged() override { pushGpuLayout(); }
+
+  // Repaint only when something on screen would change
+  void timerCallback() override {
+    if (gpu.isDrawing() != paintedWithGpu) {
+      staticLayer = {}; // notes area switches between opaque and clear
+      repaint();
+    } else if (playbackCursor != paintedCursor ||
+               octaveShift != paintedOctave ||
+               (!paintedWithGpu && !notesLayerValid)) {
+      repaint();
+    }
+  }
+
+private:
+  static constexpr int headerHeight = 20;
+
+  float getSpeedScale() const {
+    return (zoomX > 0.1f ? zoomX : 10.0f) / 480.0f; // pixels per tick
+  }
+
+  // Background, wheel strip, key grid and timeline header
+  void updateStaticLayer() {
     int w = getWidth();
     int h = getHeight();
+    if (w <= 0 || h <= 0)
+      return;
+    if (staticLayer.isValid() && staticLayer.getWidth() == w &&
+        staticLayer.getHeight() == h && wheelStripWidth == noteXStrip)
+      return;
+
+    // Under the GPU renderer the notes area must let the GL output through
+    staticLayer = juce::Image(juce::Image::ARGB, w, h, true);
+    juce::Graphics g(staticLayer);
+    if (!paintedWithGpu)
+      g.fillAll(Theme::bgDark);
 
     float availableW = (float)w; // Fallback
 
@@ -77,24 +149,10 @@ public:
       g.drawVerticalLine(wheelStripWidth, 0, (float)h);
       availableW -= wheelStripWidth;
     }
-    float totalRatio = 0;
-    for (int i = 0; i < 128; ++i)
-      totalRatio += NoteWidthRatios[i % 12];
-    float unitW = availableW / totalRatio;
-
-    auto getNoteX = [&](int note) {
-      float x = (float)wheelStripWidth;
-      for (int i = 0; i < note; ++i)
-        x += NoteWidthRatios[i % 12] * unitW;
-      return x;
-    };
-
-    auto getNoteW = [&](int note) {
-      return NoteWidthRatios[note % 12] * unitW;
-    };
+    rebuildNoteX(availableW);
 
     for (int i = 0; i <= 128; ++i) {
-      float x = getNoteX(i);
+      float x = noteX[(size_t)i];
       if (i % 12 == 0)
         g.setColour(Theme::grid.withAlpha(0.5f)); // C notes stronger
       else
@@ -102,62 +160,114 @@ public:
       g.drawVerticalLine((int)x, 0.0f, (float)h);
     }
 
-    float speedScale = (zoomX > 0.1f ? zoomX : 10.0f) / 480.0f;
-
-    if (sequence && sequence->getEndTime() > 0) {
-      // Draw individual notes
-      g.setColour(Theme::accent);
-      float currentTick = playbackCursor;
-
-      // -- FIX: Clip notes so they don't draw over the timeline header --
-      juce::Graphics::ScopedSaveState ss(g);
-      g.reduceClipRegion(0, 20, w, h - 20);
-
-      for (int i = 0; i < sequence->getNumEvents(); ++i) {
-        auto *ev = sequence->getEventPointer(i);
-        if (ev->message.isNoteOn()) {
-          auto note = ev->message.getNoteNumber();
-          int displayNote = note + (octaveShift * 12);
-          if (displayNote < 0 || displayNote > 127)
-            continue;
-
-          auto startTime = ev->message.getTimeStamp();
-          double endTime = startTime + 240.0;
-          if (ev->noteOffObject)
-            endTime = ev->noteOffObject->message.getTimeStamp();
-
-          float yEnd = h - (float)(startTime - currentTick) * speedScale;
-          float yStart = h - (float)(endTime - currentTick) * speedScale;
-
-          if (yEnd < 0)
-            continue;
-          if (yStart > h)
-            continue;
-
-          float rectX = getNoteX(displayNote) + 1.0f;
-          float rectW = juce::jmax(2.0f, getNoteW(displayNote) - 1.0f);
-          float rectH = yEnd - yStart;
-
-          g.setColour(Theme::getChannelColor(ev->message.getChannel()));
-          g.fillRect(rectX, yStart, rectW, rectH);
-        }
-      }
-    }
-
-    // Timeline Header (Draw LAST to stay on top)
+    // Timeline Header
     g.setColour(Theme::bgPanel.brighter(0.1f));
-    g.fillRect(0, 0, w, 20);
+    g.fillRect(0, 0, w, headerHeight);
     g.setColour(juce::Colours::white);
-    g.drawText("Timeline", 5, 0, 100, 20, juce::Justification::centredLeft);
+    g.drawText("Timeline", 5, 0, 100, headerHeight,
+               juce::Justification::centredLeft);
 
-    // Progress marker on timeline
-    if (sequence && sequence->getEndTime() > 0) {
-      double progress = playbackCursor / sequence->getEndTime();
-      float markerX = (float)progress * w;
-      g.setColour(juce::Colours::red);
-      g.fillRect(markerX - 2, 0.0f, 4.0f, 20.0f);
+    notesLayerValid = false; // key positions may have moved
+  }
+
+  // Brings the notes layer to `tick`: whole-pixel scroll plus a strip when
+  // moving forward, full redraw on seeks, octave changes or a new file
+  void updateNotesLayer(float tick) {
+    int w = getWidth();
+    int lh = getHeight() - headerHeight;
+    if (w <= 0 || lh <= 0)
+      return;
+    if (!notesLayer.isValid() || notesLayer.getWidth() != w ||
+        notesLayer.getHeight() != lh) {
+      notesLayer = juce::Image(juce::Image::ARGB, w, lh, true);
+      notesLayerValid = false;
     }
+
+    const float scale = getSpeedScale();
+    const int octave = octaveShift;
+    int dy = (int)std::floor((tick - layerTick) * scale);
+
+    if (notesLayerValid && octave == layerOctave && dy >= 0 && dy < lh) {
+      if (dy == 0)
+        return;
+      layerTick += dy / scale;
+      notesLayer.moveImageSection(0, dy, 0, 0, w, lh - dy);
+      notesLayer.clear({0, 0, w, dy});
+      drawNotes(0, dy);
+      return;
+    }
+
+    layerTick = tick;
+    layerOctave = octave;
+    notesLayer.clear(notesLayer.getBounds());
+    drawNotes(0, lh);
+    notesLayerValid = true;
   }
 
-  void timerCallback() override { repaint(); }
+  // Draws the notes crossing rows [top, bottom) of the notes layer
+  void drawNotes(int top, int bottom) {
+    if (notes == nullptr || notes->getEndTick() <= 0)
+      return;
+    juce::Graphics g(notesLayer);
+    g.reduceClipRegion(0, top, notesLayer.getWidth(), bottom - top);
+
+    const float scale = getSpeedScale();
+    const float baseY = (float)notesLayer.getHeight(); // cursor line
+    const int shift = layerOctave * 12;
+    double fromTick = layerTick + (baseY - bottom) / scale;
+    double toTick = layerTick + (baseY - top) / scale;
+
+    notes->forEachInWindow(fromTick, toTick, [&](const NoteInterval &n) {
+      int displayNote = n.note + shift;
+      if (displayNote < 0 || displayNote > 127)
+        return;
+
+      float yEnd = baseY - (float)(n.start - layerTick) * scale;
+      float yStart = baseY - (float)(n.end - layerTick) * scale;
+
+      auto key = (size_t)displayNote;
+      float rectX = noteX[key] + 1.0f;
+      float rectW = juce::jmax(2.0f, noteX[key + 1] - noteX[key] - 1.0f);
+
+      g.setColour(Theme::getChannelColor(n.channel));
+      g.fillRect(rectX, yStart, rectW, yEnd - yStart);
+    });
+  }
+
+  // Left edge of every key plus the right edge of the last, in pixels.
+  // Depends only on the width, so it's rebuilt on resize, not per frame.
+  void rebuildNoteX(float availableW) {
+    float totalRatio = 0;
+    for (int i = 0; i < 128; ++i)
+      totalRatio += NoteWidthRatios[i % 12];
+    float unitW = availableW / totalRatio;
+
+    float x = (float)wheelStripWidth;
+    for (int i = 0; i < 128; ++i) {
+      noteX[(size_t)i] = x;
+      x += NoteWidthRatios[i % 12] * unitW;
+    }
+    noteX[128] = x;
+    noteXStrip = wheelStripWidth;
+    pushGpuLayout();
+  }
+
+  // The renderer draws in the parent's (the GL target's) coordinates
+  void pushGpuLayout() {
+    juce::Rectangle<int> area;
+    if (isVisible() && getParentComponent() != nullptr)
+      area = getBoundsInParent().withTrimmedTop(headerHeight);
+    gpu.setLayout(area, noteX, getSpeedScale());
+  }
+
+  std::array<float, 129> noteX{};
+  int noteXStrip = -1;
+
+  std::shared_ptr<const LoadedMidiFile> loadedFile;
+  juce::Image staticLayer, notesLayer;
+  bool notesLayerValid = false, paintedWithGpu = false;
+  double layerTick = 0.0; // cursor the notes layer is drawn for
+  int layerOctave = 0;
+  float paintedCursor = -1.0f;
+  int paintedOctave = 0;
 };
\ No newline at end of file